@@ -2,27 +2,39 @@
 #include <cstdlib>
 #include <iostream>
 #include <omp.h>
+#include "../common/numa_alloc.h"
+#include "../common/rng.h"
+#include "../common/vexpr.h"
 
 using namespace std::chrono;
 using namespace std;
 
-void randomVector(int vector[], int size) {
-    for (int i = 0; i < size; i++) {
-        vector[i] = rand() % 100;
-    }
+// Values in [0, 100), filled in parallel with the same static split as the
+// OpenMP loops below, so each thread first-touches the pages it later uses
+void randomVector(int vector[], unsigned long size, uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 100);
+    rng_fill_ints(vector, size, &spec);
 }
 
 int main() {
     unsigned long size = 100000000;
-    srand(time(0));
+    size_t bytes = size * sizeof(int);
 
+    // Untouched, huge-page backed buffers; pin the threads (NUMA_PIN=1) before
+    // the parallel fills decide which node each page lives on
+    numa_pin_openmp_threads();
     int *v1, *v2, *v3;
-    v1 = (int *)malloc(size * sizeof(int));
-    v2 = (int *)malloc(size * sizeof(int));
-    v3 = (int *)malloc(size * sizeof(int));
+    v1 = (int *)numa_buffer_alloc(bytes, 0);
+    v2 = (int *)numa_buffer_alloc(bytes, 0);
+    v3 = (int *)numa_buffer_alloc(bytes, 0);
+    if (!v1 || !v2 || !v3) {
+        cerr << "Allocation failed" << endl;
+        return 1;
+    }
 
-    randomVector(v1, size);
-    randomVector(v2, size);
+    randomVector(v1, size, RNG_DEFAULT_SEED);
+    randomVector(v2, size, RNG_DEFAULT_SEED + 1);
+    numa_first_touch(v3, bytes);
 
     // Sequential Execution
     auto start_seq = high_resolution_clock::now();
@@ -35,7 +47,7 @@ int main() {
 
     // OpenMP Parallel Execution
     auto start_omp = high_resolution_clock::now();
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < size; i++) {
         v3[i] = v1[i] + v2[i];
     }
@@ -43,9 +55,31 @@ int main() {
     auto duration_omp = duration_cast<microseconds>(stop_omp - start_omp);
     cout << "Time taken by OpenMP parallel execution: " << duration_omp.count() << " microseconds" << endl;
 
-    free(v1);
-    free(v2);
-    free(v3);
+    // Add followed by a sum: as two parallel loops, v3 makes a second trip
+    // through memory; fused, each element is summed as it is stored
+    auto start_two = high_resolution_clock::now();
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)size; i++) {
+        v3[i] = v1[i] + v2[i];
+    }
+    long long sum_two = 0;
+    #pragma omp parallel for schedule(static) reduction(+:sum_two)
+    for (long long i = 0; i < (long long)size; i++) {
+        sum_two += v3[i];
+    }
+    auto stop_two = high_resolution_clock::now();
+    cout << "Time taken by add, then sum (2 passes): " << duration_cast<microseconds>(stop_two - start_two).count()
+         << " microseconds, sum " << sum_two << endl;
+
+    auto start_fused = high_resolution_clock::now();
+    long long sum_fused = vexpr::assignSum(vexpr::span(v3, size), vexpr::span(v1, size) + vexpr::span(v2, size));
+    auto stop_fused = high_resolution_clock::now();
+    cout << "Time taken by fused add + sum (1 pass): " << duration_cast<microseconds>(stop_fused - start_fused).count()
+         << " microseconds, sum " << sum_fused << endl;
+
+    numa_buffer_free(v1, bytes);
+    numa_buffer_free(v2, bytes);
+    numa_buffer_free(v3, bytes);
 
     return 0;
 }
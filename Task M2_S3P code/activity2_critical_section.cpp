@@ -2,26 +2,32 @@
 #include <chrono>
 #include <cstdlib>
 #include <omp.h>
+#include "../common/rng.h"
 
 using namespace std;
 using namespace chrono;
 
-void randomVector(int *vector, int size) {
-    for (int i = 0; i < size; i++) {
-        vector[i] = rand() % 100;
-    }
+// Values in [0, 100)
+void randomVector(int *vector, int size, uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 100);
+    rng_fill_ints(vector, size, &spec);
 }
 
 int main() {
     int size = 100000;
-    srand(time(0));
 
     int *v1 = new int[size];
     int *v2 = new int[size];
     int *v3 = new int[size];
 
-    randomVector(v1, size);
-    randomVector(v2, size);
+    randomVector(v1, size, RNG_DEFAULT_SEED);
+    randomVector(v2, size, RNG_DEFAULT_SEED + 1);
+
+    // v3 = v1 + v2 is the vector summed below
+    #pragma omp parallel for
+    for (int i = 0; i < size; i++) {
+        v3[i] = v1[i] + v2[i];
+    }
 
     long long total = 0;
 
@@ -1,39 +1,258 @@
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
 #include <omp.h>
+#include "../common/rng.h"
+#include "../common/reduce.h"
+#include "../common/bench.h"
 
 using namespace std;
 using namespace chrono;
 
-void randomVector(int *vector, int size) {
-    for (int i = 0; i < size; i++) {
-        vector[i] = rand() % 100;
+// Sums v3 = v1 + v2 with one of the strategies in common/reduce.h, or with
+// --benchmark sweeps every strategy over thread counts, sizes and element
+// types (int, float, double) and recommends the fastest correct one per type.
+// Integers skip pairwise and kahan, which only differ from padded in rounding.
+// "Correct" means exact for int, and a relative error of at most 100 * epsilon
+// against a long double reference for float and double. Each size is summed
+// twice: uniform random values, and a constant (0.1 for floating types),
+// which exposes error that grows with n where random data averages it out.
+//
+// Usage: activity2_reduction [--strategy NAME] [--size N] [--threads T]
+//                            [--benchmark] [--iterations I] [--json PATH]
+// Build: g++ -O3 -march=native -fopenmp activity2_reduction.cpp -o activity2_reduction
+
+// Values in [0, 100)
+void randomVector(int *vector, int size, uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 100);
+    rng_fill_ints(vector, size, &spec);
+}
+
+void randomVector(float *vector, size_t size, uint64_t seed) {
+    rng_fill_floats(vector, size, seed, 0.0f, 100.0f);
+}
+
+void randomVector(double *vector, size_t size, uint64_t seed) {
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)size; i++) {
+        vector[i] = 100.0 * rng_unit(rng_at(seed, (uint64_t)i));
+    }
+}
+
+// Uniform random values, or every element the same
+template <typename T>
+void fillInput(T *x, size_t n, bool constant) {
+    if (!constant) {
+        randomVector(x, n, RNG_DEFAULT_SEED);
+        return;
+    }
+    const T value = std::is_integral<T>::value ? T(7) : T(0.1);
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)n; i++) {
+        x[i] = value;
+    }
+}
+
+struct Options {
+    reduce::Strategy strategy = reduce::Strategy::Clause;
+    size_t size = 100000;
+    int threads = 0;
+    bool benchmark = false;
+    int iterations = 10;
+    string json;
+};
+
+struct Row {
+    string type;
+    const char *data;   // "random" or "constant"
+    reduce::Strategy strategy;
+    size_t size;
+    int threads;
+    bench::Stats stats;
+    double error;       // relative to the long double reference
+    bool correct;
+};
+
+// 1, 2, 4, ... up to the limit, plus the limit itself
+vector<int> threadSweep(int limit) {
+    vector<int> counts;
+    for (int t = 1; t < limit; t *= 2) counts.push_back(t);
+    counts.push_back(limit);
+    return counts;
+}
+
+template <typename T>
+void sweep(const char *type, const vector<size_t> &sizes, const vector<int> &threads, int iterations,
+           vector<Row> &rows) {
+    for (size_t n : sizes) {
+        vector<T> x(n);
+        for (int constant = 0; constant < 2; constant++) {
+            const char *data = constant ? "constant" : "random";
+            fillInput(x.data(), n, constant);
+            // Compensated, so the reference itself does not drift on the
+            // constant input
+            long double reference = 0, correction = 0;
+            for (size_t i = 0; i < n; i++) reduce::detail::kahanAdd(reference, correction, (long double)x[i]);
+
+            for (reduce::Strategy s : reduce::ALL_STRATEGIES) {
+                if (!reduce::appliesTo<T>(s)) continue;
+                for (int t : threads) {
+                    typename reduce::SumType<T>::type result = 0;
+                    bench::Stats stats =
+                        bench::measure(1, iterations, [&] { result = reduce::sum(x.data(), n, s, t); });
+                    double error =
+                        reference != 0 ? double(fabsl(((long double)result - reference) / reference)) : 0.0;
+                    bool correct = std::is_integral<T>::value
+                                       ? (long double)result == reference
+                                       : error <= 100.0 * double(numeric_limits<T>::epsilon());
+                    rows.push_back({type, data, s, n, t, stats, error, correct});
+                    printf("%-7s %-9s %-9s %10zu %7d %12.1f %12.3g  %s\n", type, data, reduce::strategyName(s), n,
+                           t, stats.median * 1e6, error, correct ? "ok" : "INACCURATE");
+                }
+            }
+        }
+    }
+}
+
+// Fastest strategy that is correct for every input, size and thread count:
+// least total median time over them at the largest thread count. Strategies
+// the sweep skipped for this type have no rows and are not candidates.
+bool recommend(const vector<Row> &rows, const string &type, int threads, reduce::Strategy &best) {
+    double bestTime = 0;
+    bool found = false;
+    for (reduce::Strategy s : reduce::ALL_STRATEGIES) {
+        bool measured = false, correct = true;
+        double time = 0;
+        for (const Row &r : rows) {
+            if (r.type != type || r.strategy != s) continue;
+            measured = true;
+            correct = correct && r.correct;
+            if (r.threads == threads) time += r.stats.median;
+        }
+        if (measured && correct && (!found || time < bestTime)) {
+            best = s;
+            bestTime = time;
+            found = true;
+        }
     }
+    return found;
 }
 
-int main() {
-    int size = 100000;
-    srand(time(0));
+int benchmark(const Options &opt) {
+    const int limit = opt.threads > 0 ? opt.threads : omp_get_max_threads();
+    const vector<int> threads = threadSweep(limit);
+    const vector<size_t> sizes = {1000, 100000, 10000000};
+
+    vector<Row> rows;
+    printf("%-7s %-9s %-9s %10s %7s %12s %12s\n", "type", "data", "strategy", "size", "threads", "median us", "rel error");
+    sweep<int>("int", sizes, threads, opt.iterations, rows);
+    sweep<float>("float", sizes, threads, opt.iterations, rows);
+    sweep<double>("double", sizes, threads, opt.iterations, rows);
+
+    const char *types[] = {"int", "float", "double"};
+    reduce::Strategy best[3];
+    bool found[3];
+    printf("\nFastest correct strategy at %d threads:\n", limit);
+    for (int k = 0; k < 3; k++) {
+        found[k] = recommend(rows, types[k], limit, best[k]);
+        printf("  %-7s %s\n", types[k], found[k] ? reduce::strategyName(best[k]) : "none");
+    }
+
+    if (opt.json.empty()) return 0;
+    FILE *out = fopen(opt.json.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", opt.json.c_str());
+        return 1;
+    }
+    bench::JsonWriter json(out);
+    json.beginObject();
+    json.field("tool", "activity2_reduction");
+    json.field("iterations", opt.iterations);
+    json.key("results").beginArray();
+    for (const Row &r : rows) {
+        json.beginObject();
+        json.field("type", r.type);
+        json.field("data", r.data);
+        json.field("strategy", reduce::strategyName(r.strategy));
+        json.field("size", (long long)r.size);
+        json.field("threads", r.threads);
+        json.stats("time", r.stats);
+        json.field("relative_error", r.error);
+        json.field("correct", r.correct);
+        json.endObject();
+    }
+    json.endArray();
+    json.key("recommended").beginObject();
+    for (int k = 0; k < 3; k++) {
+        json.field(types[k], found[k] ? reduce::strategyName(best[k]) : "none");
+    }
+    json.endObject();
+    json.endObject();
+    json.finish();
+    fclose(out);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--strategy") == 0 && i + 1 < argc) {
+            if (!reduce::parseStrategy(argv[++i], opt.strategy)) {
+                fprintf(stderr, "Unknown strategy %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            opt.size = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opt.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            opt.benchmark = true;
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            opt.iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            opt.json = argv[++i];
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [--strategy atomic|critical|clause|padded|simd|pairwise|kahan] [--size N]\n"
+                    "          [--threads T] [--benchmark] [--iterations I] [--json PATH]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (opt.size < 1 || opt.iterations < 1) {
+        fprintf(stderr, "--size and --iterations must be positive\n");
+        return 1;
+    }
+    if (opt.benchmark) return benchmark(opt);
+
+    int size = (int)opt.size;
 
     int *v1 = new int[size];
     int *v2 = new int[size];
     int *v3 = new int[size];
 
-    randomVector(v1, size);
-    randomVector(v2, size);
+    randomVector(v1, size, RNG_DEFAULT_SEED);
+    randomVector(v2, size, RNG_DEFAULT_SEED + 1);
 
-    long long total = 0;
+    // v3 = v1 + v2 is the vector summed below
+    #pragma omp parallel for
+    for (int i = 0; i < size; i++) {
+        v3[i] = v1[i] + v2[i];
+    }
 
     auto start = high_resolution_clock::now();
 
-    #pragma omp parallel for reduction(+:total)
-    for (int i = 0; i < size; i++) {
-        total += v3[i];
-    }
+    long long total = reduce::sum(v3, size, opt.strategy, opt.threads);
 
     auto stop = high_resolution_clock::now();
-    cout << "Total sum: " << total << "\nTime taken: " << duration_cast<microseconds>(stop - start).count() << " microseconds\n";
+    cout << "Strategy: " << reduce::strategyName(opt.strategy) << "\nTotal sum: " << total
+         << "\nTime taken: " << duration_cast<microseconds>(stop - start).count() << " microseconds\n";
 
     delete[] v1;
     delete[] v2;
@@ -1,36 +1,94 @@
 #include <iostream>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <omp.h>
+#include "../common/rng.h"
+#include "../common/omp_schedule.h"
 
 using namespace std;
 using namespace chrono;
 
-void randomVector(int *vector, int size) {
-    for (int i = 0; i < size; i++) {
-        vector[i] = rand() % 100;
-    }
+// Times v3 = v1 + v2 under the schedules in common/omp_schedule.h: every
+// kind in turn, or just the one given with --schedule (e.g. dynamic,4).
+// The loop runs --repeat times so the adaptive schedule can use what it
+// measured on the first run; --report prints each thread's busy time.
+//
+// Usage: activity2_scheduling [--schedule KIND[,CHUNK]] [--size N] [--grain G]
+//                             [--threads T] [--repeat R] [--report]
+
+// Values in [0, 100)
+void randomVector(int *vector, int size, uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 100);
+    rng_fill_ints(vector, size, &spec);
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     int size = 100000;
-    srand(time(0));
+    long grain = 1024; // elements per work unit
+    int threads = 0;
+    int repeat = 10;
+    bool report = false;
+    bool sweep = true;
+    sched_kind kind = SCHED_STATIC;
+    long chunk = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--schedule") == 0 && i + 1 < argc) {
+            if (sched_parse(argv[++i], &kind, &chunk) != 0) {
+                cerr << "Unknown schedule " << argv[i] << endl;
+                return 1;
+            }
+            sweep = false;
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--grain") == 0 && i + 1 < argc) grain = atol(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--report") == 0) report = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--schedule static|dynamic|guided|runtime|adaptive[,CHUNK]] [--size N]"
+                 << " [--grain G] [--threads T] [--repeat R] [--report]" << endl;
+            return 1;
+        }
+    }
+    if (size < 1 || grain < 1 || repeat < 1) {
+        cerr << "--size, --grain and --repeat must be positive" << endl;
+        return 1;
+    }
 
     int *v1 = new int[size];
     int *v2 = new int[size];
     int *v3 = new int[size];
 
-    randomVector(v1, size);
-    randomVector(v2, size);
+    randomVector(v1, size, RNG_DEFAULT_SEED);
+    randomVector(v2, size, RNG_DEFAULT_SEED + 1);
 
-    auto start = high_resolution_clock::now();
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < size; i++) {
-        v3[i] = v1[i] + v2[i];
-    }
+    for (int k = 0; k < SCHED_KIND_COUNT; k++) {
+        if (!sweep && k != kind) continue;
+        sched_loop loop;
+        sched_loop_init(&loop, sweep ? (sched_kind)k : kind, sweep ? 0 : chunk, threads);
+        loop.grain = grain;
+        // LOOP_SCHEDULE would make every row of the sweep the same schedule
+        if (!sweep) sched_loop_env(&loop);
+
+        long long first = 0, rest = 0;
+        for (int r = 0; r < repeat; r++) {
+            auto start = high_resolution_clock::now();
+            runScheduled(loop, size, [&](long begin, long end) {
+                for (long i = begin; i < end; i++) {
+                    v3[i] = v1[i] + v2[i];
+                }
+            });
+            auto stop = high_resolution_clock::now();
+            long long us = duration_cast<microseconds>(stop - start).count();
+            if (r == 0) first = us;
+            else rest += us;
+        }
 
-    auto stop = high_resolution_clock::now();
-    cout << "Time taken with static scheduling: " << duration_cast<microseconds>(stop - start).count() << " microseconds\n";
+        cout << "Time taken with " << sched_kind_name(loop.kind) << " scheduling: "
+             << (repeat > 1 ? rest / (repeat - 1) : first) << " microseconds (first run " << first << ")\n";
+        if (report) sched_report(&loop, stdout);
+        sched_loop_free(&loop);
+    }
 
     delete[] v1;
     delete[] v2;
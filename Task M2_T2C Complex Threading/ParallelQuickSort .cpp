@@ -1,51 +1,150 @@
 #include <iostream>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <algorithm>
+#include <string>
+#include <cstdio>
 #include <omp.h>
+#include "../common/external_sort.h"
+#include "../common/quicksort.h"
+#include "../common/radix_sort.h"
+#include "../common/rng.h"
 
-void quickSortParallel(std::vector<int>& arr, int left, int right) {
-    if (left < right) {
-        int pivot = arr[right];
-        int i = left - 1;
+// One parallel region for the whole sort: each partition step spawns a task
+// for its left half and keeps the right half, and ranges below the cutoff
+// are finished with a serial introsort (common/quicksort.h). Large ranges
+// are partitioned by all threads, around a ninther pivot.
+void quickSortParallel(std::vector<int>& arr, int numThreads, std::ptrdiff_t cutoff) {
+    sorting::parallelQuicksort(arr.data(), arr.data() + arr.size(), numThreads, cutoff);
+}
 
-        for (int j = left; j < right; ++j) {
-            if (arr[j] < pivot) {
-                ++i;
-                std::swap(arr[i], arr[j]);
-            }
-        }
-        std::swap(arr[i + 1], arr[right]);
-
-        int partitionIndex = i + 1;
-
-        #pragma omp parallel sections
-        {
-            #pragma omp section
-            {
-                quickSortParallel(arr, left, partitionIndex - 1);
-            }
-            #pragma omp section
-            {
-                quickSortParallel(arr, partitionIndex + 1, right);
-            }
+// Parallel LSD radix sort over the key range actually present (common/radix_sort.h)
+void radixSortParallel(std::vector<int>& arr, int numThreads) {
+    sorting::radixSort(arr.data(), arr.data() + arr.size(), numThreads);
+}
+
+// Write n keys from spec as a raw int32 file for --external, one block at a
+// time; the file is the same one the in-memory sort would generate
+bool writeKeyFile(const std::string& path, size_t n, const rng_spec& spec) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::vector<int> block(1 << 20);
+    for (size_t done = 0; done < n; done += block.size()) {
+        size_t count = std::min(block.size(), n - done);
+        rng_fill_ints_at(block.data(), done, count, n, &spec);
+        if (std::fwrite(block.data(), sizeof(int), count, f) != count) {
+            std::fclose(f);
+            return false;
         }
     }
+    return std::fclose(f) == 0;
+}
+
+// Out-of-core sort of a key file through common/external_sort.h, with the
+// time and throughput of every phase
+int sortKeyFile(const std::string& input, const std::string& output, const sorting::ExternalSortOptions& options) {
+    double start = omp_get_wtime();
+    sorting::ExternalSortStats stats;
+    try {
+        stats = sorting::externalSort(input, output, options);
+    } catch (const std::exception& e) {
+        std::cerr << "External sort failed: " << e.what() << std::endl;
+        return 1;
+    }
+    double total = omp_get_wtime() - start;
+
+    const double MB = 1024.0 * 1024.0;
+    std::cout << "External sort of " << stats.keys << " keys in " << stats.runs << " runs" << std::endl;
+    for (const sorting::ExternalSortPhase& phase : stats.phases) {
+        double seconds = std::max(phase.seconds, 1e-9);
+        std::printf("  %-16s %8.3f s  read %9.1f MB (%7.1f MB/s)  write %9.1f MB (%7.1f MB/s)  read stalls %.3f s\n",
+                    phase.name.c_str(), phase.seconds, phase.bytesRead / MB, phase.bytesRead / MB / seconds,
+                    phase.bytesWritten / MB, phase.bytesWritten / MB / seconds, phase.waitSeconds);
+    }
+    std::printf("  sorting in memory %.3f s, total %.3f s\n", stats.sortSeconds, total);
+    return 0;
 }
 
-int main() {
-    std::vector<int> arr(1000000);
-    std::srand(std::time(0));
-    for (int& num : arr) {
-        num = std::rand() % 1000000;
+int main(int argc, char* argv[]) {
+    size_t n = 1000000;
+    int numThreads = 0; // 0 = OpenMP default
+    std::ptrdiff_t cutoff = sorting::DEFAULT_TASK_CUTOFF;
+    std::string algo = "quick"; // quick, radix or auto
+    rng_dist dist = RNG_UNIFORM;
+    uint64_t seed = RNG_DEFAULT_SEED;
+    std::string externalIn, externalOut, makeInput;
+    sorting::ExternalSortOptions external;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) n = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) numThreads = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--cutoff") == 0 && i + 1 < argc) cutoff = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--algo") == 0 && i + 1 < argc) algo = argv[++i];
+        else if (std::strcmp(argv[i], "--dist") == 0 && i + 1 < argc && rng_parse_dist(argv[i + 1], &dist) == 0) i++;
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--external") == 0 && i + 2 < argc) {
+            externalIn = argv[++i];
+            externalOut = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--memory") == 0 && i + 1 < argc) external.memoryBytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        else if (std::strcmp(argv[i], "--tmp") == 0 && i + 1 < argc) external.tempDir = argv[++i];
+        else if (std::strcmp(argv[i], "--make-input") == 0 && i + 1 < argc) makeInput = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--n N] [--threads T] [--cutoff C] [--algo quick|radix|auto]"
+                      << " [--dist uniform|sorted|reverse|few-unique|zipf] [--seed S]\n"
+                      << "       " << argv[0] << " --make-input KEYS [--n N] [--dist D] [--seed S]\n"
+                      << "       " << argv[0] << " --external IN OUT [--memory MB] [--tmp DIR] [--threads T]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Keys in [0, 1000000), reproducible for a given seed (common/rng.h)
+    rng_spec spec = rng_make_spec(dist, seed, 0, 1000000);
+
+    if (!makeInput.empty()) {
+        if (!writeKeyFile(makeInput, n, spec)) {
+            std::cerr << "Cannot write " << makeInput << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << n << " keys to " << makeInput << std::endl;
+        return 0;
+    }
+    if (!externalIn.empty()) {
+        if (external.memoryBytes == 0) {
+            std::cerr << "--memory must be at least 1 MB" << std::endl;
+            return 1;
+        }
+        external.numThreads = numThreads;
+        return sortKeyFile(externalIn, externalOut, external);
+    }
+    if (algo != "quick" && algo != "radix" && algo != "auto") {
+        std::cerr << "Unknown algorithm " << algo << std::endl;
+        return 1;
     }
 
+    std::vector<int> arr(n);
+    rng_fill_ints(arr.data(), n, &spec);
+
+    // Resolve the partition kernel (CPUID + self-check) before timing starts
+    std::cout << "Partition kernel: " << sorting::partitionIsaName(sorting::selectedPartitionIsa()) << std::endl;
+
     double start = omp_get_wtime();
-    quickSortParallel(arr, 0, arr.size() - 1);
+    // auto looks at the size and key range (one min/max scan, timed too)
+    bool radix = algo == "radix" ||
+                 (algo == "auto" && sorting::chooseSortAlgorithm(arr.data(), arr.data() + arr.size(), numThreads) ==
+                                        sorting::SortAlgorithm::Radix);
+    if (radix) radixSortParallel(arr, numThreads);
+    else quickSortParallel(arr, numThreads, cutoff);
     double end = omp_get_wtime();
 
     double timeTaken = end - start;
-    std::cout << "Parallel QuickSort took: " << timeTaken << " seconds" << std::endl;
+    std::cout << (radix ? "Parallel RadixSort took: " : "Parallel QuickSort took: ") << timeTaken << " seconds" << std::endl;
+
+    if (!std::is_sorted(arr.begin(), arr.end())) {
+        std::cerr << "Result is not sorted" << std::endl;
+        return 1;
+    }
 
     return 0;
 }
\ No newline at end of file
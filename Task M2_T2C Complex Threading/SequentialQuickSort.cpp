@@ -1,41 +1,53 @@
 #include <iostream>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <algorithm>
+#include "../common/quicksort.h"
+#include "../common/rng.h"
+
+// Serial introsort (common/quicksort.h): the pivot is a median of three or
+// Tukey's ninther rather than arr[right], so sorted and reversed inputs no
+// longer go quadratic, and heapsort caps the worst case.
+void quickSortSequential(std::vector<int>& arr) {
+    sorting::introsort(arr.data(), arr.data() + arr.size());
+}
 
-void quickSortSequential(std::vector<int>& arr, int left, int right) {
-    if (left < right) {
-        int pivot = arr[right];
-        int i = left - 1;
-
-        for (int j = left; j < right; ++j) {
-            if (arr[j] < pivot) {
-                ++i;
-                std::swap(arr[i], arr[j]);
-            }
+int main(int argc, char* argv[]) {
+    size_t n = 1000000;
+    rng_dist dist = RNG_UNIFORM;
+    uint64_t seed = RNG_DEFAULT_SEED;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) n = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--dist") == 0 && i + 1 < argc && rng_parse_dist(argv[i + 1], &dist) == 0) i++;
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--n N] [--dist uniform|sorted|reverse|few-unique|zipf] [--seed S]"
+                      << std::endl;
+            return 1;
         }
-        std::swap(arr[i + 1], arr[right]);
-
-        int partitionIndex = i + 1;
-
-        quickSortSequential(arr, left, partitionIndex - 1);
-        quickSortSequential(arr, partitionIndex + 1, right);
     }
-}
 
-int main() {
-    std::vector<int> arr(1000000);
-    std::srand(std::time(0));
-    for (int& num : arr) {
-        num = std::rand() % 1000000;
-    }
+    // Keys in [0, 1000000), reproducible for a given seed (common/rng.h)
+    std::vector<int> arr(n);
+    rng_spec spec = rng_make_spec(dist, seed, 0, 1000000);
+    rng_fill_ints(arr.data(), n, &spec);
+
+    // Resolve the partition kernel (CPUID + self-check) before timing starts
+    std::cout << "Partition kernel: " << sorting::partitionIsaName(sorting::selectedPartitionIsa()) << std::endl;
 
     clock_t start = clock();
-    quickSortSequential(arr, 0, arr.size() - 1);
+    quickSortSequential(arr);
     clock_t end = clock();
 
     double timeTaken = double(end - start) / CLOCKS_PER_SEC;
     std::cout << "Sequential QuickSort took: " << timeTaken << " seconds" << std::endl;
 
+    if (!std::is_sorted(arr.begin(), arr.end())) {
+        std::cerr << "Result is not sorted" << std::endl;
+        return 1;
+    }
+
     return 0;
 }
\ No newline at end of file
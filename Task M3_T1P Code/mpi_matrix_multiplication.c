@@ -1,14 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include "../common/mpi_partition.h"
+#include "../common/rng.h"
+
+// Build: mpicc mpi_matrix_multiplication.c -o mpi_matrix_multiplication -lm
+// (-lm for common/rng.h)
 
 #define N 100
 
-// Function to fill matrix with random values between 0 and 4
-void fillMatrix(int mat[N][N]) {
-    for (int i = 0; i < N; i++)
-        for (int j = 0; j < N; j++)
-            mat[i][j] = rand() % 5;
+// Fill matrix with values 0-4 from the counter-based generator
+// (common/rng.h); a seed always gives the same matrix
+void fillMatrix(int mat[N][N], uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 5);
+    rng_fill_ints(&mat[0][0], N * N, &spec);
 }
 
 int main(int argc, char *argv[]) {
@@ -19,14 +24,16 @@ int main(int argc, char *argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);        // Get current process rank
     MPI_Comm_size(MPI_COMM_WORLD, &size);        // Get total number of processes
 
-    int rows_per_proc = N / size;
-    int start = rank * rows_per_proc;
-    int end = (rank == size - 1) ? N : start + rows_per_proc;
+    // Rows are split as evenly as possible; the first ranks may get one fewer
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    partition_counts(N, size, N, counts, displs);
+    int start = partition_start(N, size, rank);
+    int end = start + partition_count(N, size, rank);
 
     if (rank == 0) {
-        srand(0);           // Seed for reproducible results
-        fillMatrix(A);      // Fill matrices A and B with random values
-        fillMatrix(B);
+        fillMatrix(A, RNG_DEFAULT_SEED);
+        fillMatrix(B, RNG_DEFAULT_SEED + 1);
     }
 
     // Broadcast matrices A and B to all processes
@@ -51,9 +58,10 @@ int main(int argc, char *argv[]) {
     double local_time = end_time - start_time;
 
     // Gather results from all processes
-    MPI_Gather(&C[start][0], rows_per_proc * N, MPI_INT,
-               &C[start][0], rows_per_proc * N, MPI_INT,
-               0, MPI_COMM_WORLD);
+    if (rank == 0)
+        MPI_Gatherv(MPI_IN_PLACE, 0, MPI_INT, C, counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
+    else
+        MPI_Gatherv(&C[start][0], counts[rank], MPI_INT, NULL, NULL, NULL, MPI_INT, 0, MPI_COMM_WORLD);
 
     // Print time on rank 0
     if (rank == 0) {
@@ -61,6 +69,8 @@ int main(int argc, char *argv[]) {
         printf("Execution Time: %.6f seconds\n", local_time);
     }
 
+    free(counts);
+    free(displs);
     MPI_Finalize(); // Finalize MPI
     return 0;
 }
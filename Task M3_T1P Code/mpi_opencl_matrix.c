@@ -3,14 +3,20 @@
 #define CL_TARGET_OPENCL_VERSION 120
 #include <CL/cl.h>
 #include <mpi.h>
+#include "../common/mpi_partition.h"
+#include "../common/rng.h"
+#include "../common/cl_gemm.h"
+
+// Build: mpicc mpi_opencl_matrix.c -o mpi_opencl_matrix -lOpenCL -lm
+// (-lm for common/rng.h)
 
 #define N 100
-#define MAX_SOURCE_SIZE (0x100000)
 
-void fillMatrix(int mat[N][N]) {
-    for (int i = 0; i < N; i++)
-        for (int j = 0; j < N; j++)
-            mat[i][j] = rand() % 5;
+// Fill matrix with values 0-4 from the counter-based generator
+// (common/rng.h); a seed always gives the same matrix
+void fillMatrix(int mat[N][N], uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 5);
+    rng_fill_ints(&mat[0][0], N * N, &spec);
 }
 
 int main(int argc, char* argv[]) {
@@ -21,92 +27,59 @@ int main(int argc, char* argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    int rows_per_proc = N / size;
-    int start = rank * rows_per_proc;
-    int end = (rank == size - 1) ? N : start + rows_per_proc;
+    // Rows are split as evenly as possible; the first ranks may get one fewer
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    partition_counts(N, size, N, counts, displs);
+    int start = partition_start(N, size, rank);
+    int end = start + partition_count(N, size, rank);
 
     if (rank == 0) {
-        srand(0);
-        fillMatrix(A);
-        fillMatrix(B);
+        fillMatrix(A, RNG_DEFAULT_SEED);
+        fillMatrix(B, RNG_DEFAULT_SEED + 1);
     }
 
     MPI_Bcast(A, N * N, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(B, N * N, MPI_INT, 0, MPI_COMM_WORLD);
 
+    // OpenCL setup happens once, outside the timed region: the kernel is
+    // embedded, the compiled binary is cached on disk and B stays on the device
+    double setup_start = MPI_Wtime();
+    cl_gemm gemm;
+    if (cl_gemm_init(&gemm, NULL) != CL_SUCCESS || cl_gemm_set_b(&gemm, &B[0][0], N, N) != CL_SUCCESS) {
+        printf("Rank %d: OpenCL setup failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    double setup_time = MPI_Wtime() - setup_start;
+
     double start_time = MPI_Wtime();  // Start timing
 
-    // OpenCL Setup
-    cl_platform_id platform_id;
-    cl_device_id device_id;
-    cl_context context;
-    cl_command_queue command_queue;
-    cl_program program;
-    cl_kernel kernel;
-    cl_int ret;
-
-    clGetPlatformIDs(1, &platform_id, NULL);
-    clGetDeviceIDs(platform_id, CL_DEVICE_TYPE_DEFAULT, 1, &device_id, NULL);
-    context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
-    command_queue = clCreateCommandQueue(context, device_id, 0, &ret); // Use OpenCL 1.2 version
-
-    // Load kernel source
-    FILE* f = fopen("kernel.cl", "r");
-    char* source_str = (char*)malloc(MAX_SOURCE_SIZE);
-    size_t source_size = fread(source_str, 1, MAX_SOURCE_SIZE, f);
-    fclose(f);
-
-    program = clCreateProgramWithSource(context, 1, (const char**)&source_str, &source_size, &ret);
-    clBuildProgram(program, 1, &device_id, NULL, NULL, NULL);
-    kernel = clCreateKernel(program, "mat_mul", &ret);
-
-    // Buffers
-    cl_mem a_mem = clCreateBuffer(context, CL_MEM_READ_ONLY, N * N * sizeof(int), NULL, &ret);
-    cl_mem b_mem = clCreateBuffer(context, CL_MEM_READ_ONLY, N * N * sizeof(int), NULL, &ret);
-    cl_mem c_mem = clCreateBuffer(context, CL_MEM_WRITE_ONLY, N * N * sizeof(int), NULL, &ret);
-
-    // Copy data to GPU
-    clEnqueueWriteBuffer(command_queue, a_mem, CL_TRUE, 0, N * N * sizeof(int), A, 0, NULL, NULL);
-    clEnqueueWriteBuffer(command_queue, b_mem, CL_TRUE, 0, N * N * sizeof(int), B, 0, NULL, NULL);
-
-    // Set kernel args
-    int size_n = N;
-    clSetKernelArg(kernel, 0, sizeof(cl_mem), &a_mem);
-    clSetKernelArg(kernel, 1, sizeof(cl_mem), &b_mem);
-    clSetKernelArg(kernel, 2, sizeof(cl_mem), &c_mem);
-    clSetKernelArg(kernel, 3, sizeof(int), &size_n);
-    clSetKernelArg(kernel, 4, sizeof(int), &start);
-
-    size_t global_size[2] = {end - start, N};
-    clEnqueueNDRangeKernel(command_queue, kernel, 2, NULL, global_size, NULL, 0, NULL, NULL);
-    clFinish(command_queue);
-
-    // Read back result
-    clEnqueueReadBuffer(command_queue, c_mem, CL_TRUE, 0, N * N * sizeof(int), C, 0, NULL, NULL);
+    // Only this rank's rows of A go up and only its rows of C come back
+    if (cl_gemm_multiply(&gemm, &A[start][0], end - start, &C[start][0]) != CL_SUCCESS) {
+        printf("Rank %d: OpenCL multiply failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
     double end_time = MPI_Wtime();  // End timing
     double local_time = end_time - start_time;
 
     // Gather results
-    MPI_Gather(&C[start][0], rows_per_proc * N, MPI_INT,
-               &C[start][0], rows_per_proc * N, MPI_INT,
-               0, MPI_COMM_WORLD);
+    if (rank == 0)
+        MPI_Gatherv(MPI_IN_PLACE, 0, MPI_INT, C, counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
+    else
+        MPI_Gatherv(&C[start][0], counts[rank], MPI_INT, NULL, NULL, NULL, MPI_INT, 0, MPI_COMM_WORLD);
 
     if (rank == 0) {
         printf("Hybrid MPI+OpenCL matrix multiplication complete.\n");
         printf("Execution Time: %.6f seconds\n", local_time);
+        printf("OpenCL Setup Time: %.6f seconds\n", setup_time);
     }
 
     // Cleanup
-    clReleaseMemObject(a_mem);
-    clReleaseMemObject(b_mem);
-    clReleaseMemObject(c_mem);
-    clReleaseKernel(kernel);
-    clReleaseProgram(program);
-    clReleaseCommandQueue(command_queue);
-    clReleaseContext(context);
-    free(source_str);
+    cl_gemm_release(&gemm);
 
+    free(counts);
+    free(displs);
     MPI_Finalize();
     return 0;
 }
@@ -1,15 +1,112 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <mpi.h>
+#include "../common/mpi_partition.h"
+#include "../common/rng.h"
 #include <omp.h>
 
+// Build: mpicc -fopenmp mpi_openmp_matrix.c -o mpi_openmp_matrix -lm
+// (-lm for common/rng.h)
+
 #define N 100
+#define PANEL_COLS 16   // Width of the B / C column panels in pipelined mode
+
+// Fill matrix with values 0-4 from the counter-based generator
+// (common/rng.h); a seed always gives the same matrix
+void fillMatrix(int mat[N][N], uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 5);
+    rng_fill_ints(&mat[0][0], N * N, &spec);
+}
 
-// Function to fill matrix with random numbers
-void fillMatrix(int mat[N][N]) {
-    for (int i = 0; i < N; i++)
-        for (int j = 0; j < N; j++)
-            mat[i][j] = rand() % 5;
+// Columns [c0, c0 + w) of `rows` consecutive rows of an N-column matrix
+MPI_Datatype panelType(int rows, int w) {
+    MPI_Datatype t;
+    MPI_Type_vector(rows, w, N, MPI_INT, &t);
+    MPI_Type_commit(&t);
+    return t;
+}
+
+// Pipelined multiply: B arrives in column panels via MPI_Ibcast, so panel p
+// is multiplied while panel p + 1 is still in flight, and each finished panel
+// of C is streamed back to the root with MPI_Isend. Returns the compute time.
+double multiplyPipelined(int A[N][N], int B[N][N], int C[N][N], int rank, int size,
+                         const int *counts, const int *displs, int start, int end) {
+    int num_panels = (N + PANEL_COLS - 1) / PANEL_COLS;
+    MPI_Request *bcast_reqs = (MPI_Request *)malloc(num_panels * sizeof(MPI_Request));
+    MPI_Request *send_reqs = (MPI_Request *)malloc(num_panels * sizeof(MPI_Request));
+    MPI_Request *recv_reqs = (MPI_Request *)malloc(num_panels * size * sizeof(MPI_Request));
+    int num_sends = 0, num_recvs = 0;
+    double compute_time = 0.0;
+
+    // Each rank only needs its own rows of A
+    if (rank == 0)
+        MPI_Scatterv(A, counts, displs, MPI_INT, MPI_IN_PLACE, 0, MPI_INT, 0, MPI_COMM_WORLD);
+    else
+        MPI_Scatterv(NULL, NULL, NULL, MPI_INT, &A[start][0], counts[rank], MPI_INT, 0, MPI_COMM_WORLD);
+
+    // Post every panel broadcast up front; they complete in order
+    for (int p = 0; p < num_panels; p++) {
+        int c0 = p * PANEL_COLS;
+        int w = (c0 + PANEL_COLS <= N) ? PANEL_COLS : N - c0;
+        MPI_Datatype t = panelType(N, w);
+        MPI_Ibcast(&B[0][c0], 1, t, 0, MPI_COMM_WORLD, &bcast_reqs[p]);
+        MPI_Type_free(&t);
+    }
+
+    // Root pre-posts a receive for every remote row block of every panel
+    if (rank == 0) {
+        for (int r = 1; r < size; r++) {
+            int rows = counts[r] / N;
+            if (rows == 0) continue;
+            for (int p = 0; p < num_panels; p++) {
+                int c0 = p * PANEL_COLS;
+                int w = (c0 + PANEL_COLS <= N) ? PANEL_COLS : N - c0;
+                MPI_Datatype t = panelType(rows, w);
+                MPI_Irecv(&C[displs[r] / N][c0], 1, t, r, p, MPI_COMM_WORLD, &recv_reqs[num_recvs++]);
+                MPI_Type_free(&t);
+            }
+        }
+    }
+
+    for (int p = 0; p < num_panels; p++) {
+        int c0 = p * PANEL_COLS;
+        int w = (c0 + PANEL_COLS <= N) ? PANEL_COLS : N - c0;
+        MPI_Wait(&bcast_reqs[p], MPI_STATUS_IGNORE);
+
+        double t0 = MPI_Wtime();
+        #pragma omp parallel for num_threads(4)
+        for (int i = start; i < end; i++) {
+            for (int j = c0; j < c0 + w; j++)
+                C[i][j] = 0;
+            for (int k = 0; k < N; k++) {
+                int a = A[i][k];
+                for (int j = c0; j < c0 + w; j++)
+                    C[i][j] += a * B[k][j];
+            }
+        }
+        compute_time += MPI_Wtime() - t0;
+
+        if (rank != 0 && end > start) {
+            MPI_Datatype t = panelType(end - start, w);
+            MPI_Isend(&C[start][c0], 1, t, 0, p, MPI_COMM_WORLD, &send_reqs[num_sends++]);
+            MPI_Type_free(&t);
+        }
+
+        // Give the MPI library a chance to progress the next broadcast
+        if (p + 1 < num_panels) {
+            int flag;
+            MPI_Test(&bcast_reqs[p + 1], &flag, MPI_STATUS_IGNORE);
+        }
+    }
+
+    MPI_Waitall(num_sends, send_reqs, MPI_STATUSES_IGNORE);
+    MPI_Waitall(num_recvs, recv_reqs, MPI_STATUSES_IGNORE);
+
+    free(bcast_reqs);
+    free(send_reqs);
+    free(recv_reqs);
+    return compute_time;
 }
 
 int main(int argc, char *argv[]) {
@@ -20,46 +117,64 @@ int main(int argc, char *argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);        // Get process rank
     MPI_Comm_size(MPI_COMM_WORLD, &size);        // Get total processes
 
-    int rows_per_proc = N / size;
-    int start = rank * rows_per_proc;
-    int end = (rank == size - 1) ? N : start + rows_per_proc;
+    // --pipelined overlaps the broadcast of B and the gather of C with compute
+    int pipelined = argc > 1 && strcmp(argv[1], "--pipelined") == 0;
+
+    // Rows are split as evenly as possible; the first ranks may get one fewer
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    partition_counts(N, size, N, counts, displs);
+    int start = partition_start(N, size, rank);
+    int end = start + partition_count(N, size, rank);
 
     if (rank == 0) {
-        srand(0);
-        fillMatrix(A);
-        fillMatrix(B);
+        fillMatrix(A, RNG_DEFAULT_SEED);
+        fillMatrix(B, RNG_DEFAULT_SEED + 1);
     }
 
-    // Broadcast matrices to all processes
-    MPI_Bcast(A, N * N, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(B, N * N, MPI_INT, 0, MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();  // Includes communication
+    double local_time;
 
-    double start_time = MPI_Wtime();  // Start timing
+    if (pipelined) {
+        local_time = multiplyPipelined(A, B, C, rank, size, counts, displs, start, end);
+    } else {
+        // Broadcast matrices to all processes
+        MPI_Bcast(A, N * N, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(B, N * N, MPI_INT, 0, MPI_COMM_WORLD);
 
-    // Parallel region (OpenMP)
-    #pragma omp parallel for num_threads(4)
-    for (int i = start; i < end; i++) {
-        for (int j = 0; j < N; j++) {
-            C[i][j] = 0;
-            for (int k = 0; k < N; k++) {
-                C[i][j] += A[i][k] * B[k][j];
+        double start_time = MPI_Wtime();  // Start timing
+
+        // Parallel region (OpenMP)
+        #pragma omp parallel for num_threads(4)
+        for (int i = start; i < end; i++) {
+            for (int j = 0; j < N; j++) {
+                C[i][j] = 0;
+                for (int k = 0; k < N; k++) {
+                    C[i][j] += A[i][k] * B[k][j];
+                }
             }
         }
-    }
 
-    double end_time = MPI_Wtime();  // End timing
-    double local_time = end_time - start_time;
+        double end_time = MPI_Wtime();  // End timing
+        local_time = end_time - start_time;
+
+        // Gather results at root
+        if (rank == 0)
+            MPI_Gatherv(MPI_IN_PLACE, 0, MPI_INT, C, counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
+        else
+            MPI_Gatherv(&C[start][0], counts[rank], MPI_INT, NULL, NULL, NULL, MPI_INT, 0, MPI_COMM_WORLD);
+    }
 
-    // Gather results at root
-    MPI_Gather(&C[start][0], rows_per_proc * N, MPI_INT,
-               &C[start][0], rows_per_proc * N, MPI_INT,
-               0, MPI_COMM_WORLD);
+    double total_time = MPI_Wtime() - total_start;
 
     if (rank == 0) {
-        printf("Hybrid MPI+OpenMP multiplication complete.\n");
+        printf("Hybrid MPI+OpenMP multiplication complete (%s).\n", pipelined ? "pipelined" : "blocking");
         printf("Execution Time: %.6f seconds\n", local_time);
+        printf("Total Time (with communication): %.6f seconds\n", total_time);
     }
 
+    free(counts);
+    free(displs);
     MPI_Finalize(); // Finalize MPI
     return 0;
 }
@@ -2,35 +2,169 @@
 #include <CL/cl.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
-
-#define N 16  
-
-// OpenCL kernel for partitioning and compaction
-const char *kernelSource = 
-"__kernel void partition_compact(__global int* data, int pivot, __global int* out, __global int* counts) {\n"
-"   int id = get_global_id(0);\n"
-"   int val = data[id];\n"
-"   int pos = 0;\n"
-"   \n"
-"   if (val < pivot) {\n"
-"       pos = atomic_inc(&counts[0]);\n"
-"       out[pos] = val;\n"
-"   } else if (val > pivot) {\n"
-"       pos = atomic_inc(&counts[2]) + counts[0] + counts[1];\n"
-"       out[pos] = val;\n"
-"   } else {\n"
-"       pos = atomic_inc(&counts[1]) + counts[0];\n"
-"       out[pos] = val;\n"
-"   }\n"
+#include <string.h>
+#include "../common/kway_merge.h"
+#include "../common/mpi_partition.h"
+#include "../common/rng.h"
+
+// Every rank partitions (or fully sorts) its chunk on an OpenCL device and
+// rank 0 merges the sorted chunks.
+//
+// The device work is built from one bucketing pass that runs as three
+// kernels, with no global atomics:
+//   bucket_count    each work-group counts its tile's keys per bucket
+//   scan_offsets    exclusive scan of the (bucket, group) counts gives every
+//                   group its output offset per bucket
+//   bucket_scatter  each group scans its items' counts in local memory and
+//                   writes every key to its final slot
+// Offsets are fixed before any key moves, so the output is deterministic
+// and the pass is stable. With three buckets (< pivot, == pivot, > pivot)
+// it is the partition step; with 4-bit radix digits, eight passes are a
+// complete LSD radix sort that never leaves the device (--device-sort).
+//
+// Usage: mpi_opencl_quicksort [N] [--device-sort] [--dist D] [--seed S]
+// Build: mpicc mpi_opencl_quicksort.c -o mpi_opencl_quicksort -lOpenCL -lm
+//        (-lm for common/rng.h)
+
+#define ARRAY_SIZE 16
+#define PRINT_LIMIT 64         // arrays up to this size are printed
+
+#define LOCAL_SIZE 128         // work-items per group
+#define PER_ITEM 16            // consecutive keys per work-item
+#define TILE_SIZE (LOCAL_SIZE * PER_ITEM)
+#define RADIX_BITS 4
+#define BUCKETS (1 << RADIX_BITS)
+
+// LOCAL, PER_ITEM and BUCKETS come from the build options
+const char *kernelSource =
+"#define TILE (LOCAL * PER_ITEM)\n"
+"\n"
+"// shift < 0: 0/1/2 for keys below/equal to/above pivot; otherwise the\n"
+"// radix digit at `shift` of the key with its sign bit flipped\n"
+"int bucket_of(int v, int pivot, int shift) {\n"
+"    if (shift < 0) return v < pivot ? 0 : (v == pivot ? 1 : 2);\n"
+"    return (int)((((uint)v ^ 0x80000000u) >> shift) & (BUCKETS - 1));\n"
+"}\n"
+"\n"
+"// Each work-item owns PER_ITEM consecutive keys of its group's tile and\n"
+"// stores its count per bucket in hist[bucket * LOCAL + lid]\n"
+"void count_items(__global const int* in, int n, int pivot, int shift, __local int* hist) {\n"
+"    int lid = get_local_id(0);\n"
+"    int begin = get_group_id(0) * TILE + lid * PER_ITEM;\n"
+"    int end = min(begin + PER_ITEM, n);\n"
+"    int cnt[BUCKETS];\n"
+"    for (int b = 0; b < BUCKETS; b++) cnt[b] = 0;\n"
+"    for (int i = begin; i < end; i++) cnt[bucket_of(in[i], pivot, shift)]++;\n"
+"    for (int b = 0; b < BUCKETS; b++) hist[b * LOCAL + lid] = cnt[b];\n"
+"}\n"
+"\n"
+"// counts[bucket * groups + group] = keys of the group's tile in bucket\n"
+"__kernel void bucket_count(__global const int* in, int n, int pivot, int shift, __global int* counts) {\n"
+"    __local int hist[BUCKETS * LOCAL];\n"
+"    int lid = get_local_id(0);\n"
+"    count_items(in, n, pivot, shift, hist);\n"
+"    barrier(CLK_LOCAL_MEM_FENCE);\n"
+"    if (lid < BUCKETS) {\n"
+"        int sum = 0;\n"
+"        for (int i = 0; i < LOCAL; i++) sum += hist[lid * LOCAL + i];\n"
+"        counts[lid * get_num_groups(0) + get_group_id(0)] = sum;\n"
+"    }\n"
+"}\n"
+"\n"
+"// In-place exclusive scan of counts[0..m), run as a single work-group\n"
+"__kernel void scan_offsets(__global int* counts, int m) {\n"
+"    __local int tmp[LOCAL];\n"
+"    int lid = get_local_id(0);\n"
+"    int carry = 0;\n"
+"    for (int base = 0; base < m; base += LOCAL) {\n"
+"        int v = base + lid < m ? counts[base + lid] : 0;\n"
+"        tmp[lid] = v;\n"
+"        barrier(CLK_LOCAL_MEM_FENCE);\n"
+"        for (int off = 1; off < LOCAL; off <<= 1) {\n"
+"            int add = lid >= off ? tmp[lid - off] : 0;\n"
+"            barrier(CLK_LOCAL_MEM_FENCE);\n"
+"            tmp[lid] += add;\n"
+"            barrier(CLK_LOCAL_MEM_FENCE);\n"
+"        }\n"
+"        if (base + lid < m) counts[base + lid] = carry + tmp[lid] - v;\n"
+"        carry += tmp[LOCAL - 1];\n"
+"        barrier(CLK_LOCAL_MEM_FENCE);\n"
+"    }\n"
+"}\n"
+"\n"
+"// Write every key to offsets[bucket * groups + group] plus the keys of the\n"
+"// same bucket held by earlier work-items and earlier in its own run\n"
+"__kernel void bucket_scatter(__global const int* in, __global int* out, int n, int pivot, int shift,\n"
+"                             __global const int* offsets) {\n"
+"    __local int hist[BUCKETS * LOCAL];\n"
+"    int lid = get_local_id(0);\n"
+"    count_items(in, n, pivot, shift, hist);\n"
+"    barrier(CLK_LOCAL_MEM_FENCE);\n"
+"    if (lid < BUCKETS) {\n"
+"        int sum = offsets[lid * get_num_groups(0) + get_group_id(0)];\n"
+"        for (int i = 0; i < LOCAL; i++) {\n"
+"            int c = hist[lid * LOCAL + i];\n"
+"            hist[lid * LOCAL + i] = sum;\n"
+"            sum += c;\n"
+"        }\n"
+"    }\n"
+"    barrier(CLK_LOCAL_MEM_FENCE);\n"
+"    int pos[BUCKETS];\n"
+"    for (int b = 0; b < BUCKETS; b++) pos[b] = hist[b * LOCAL + lid];\n"
+"    int begin = get_group_id(0) * TILE + lid * PER_ITEM;\n"
+"    int end = min(begin + PER_ITEM, n);\n"
+"    for (int i = begin; i < end; i++) {\n"
+"        int v = in[i];\n"
+"        out[pos[bucket_of(v, pivot, shift)]++] = v;\n"
+"    }\n"
 "}\n";
 
+// Kernels and scratch for bucketing passes over up to n keys
+typedef struct {
+    cl_command_queue queue;
+    cl_kernel count, scan, scatter;
+    cl_mem counts;          // BUCKETS * groups ints, offsets after the scan
+    int groups;
+} bucket_pass;
+
+// One stable bucketing pass from in to out; shift < 0 partitions around
+// pivot, otherwise buckets by the radix digit at shift
+cl_int run_bucket_pass(const bucket_pass *p, cl_mem in, cl_mem out, int n, int pivot, int shift) {
+    size_t local = LOCAL_SIZE;
+    size_t global = (size_t)p->groups * LOCAL_SIZE;
+    int m = BUCKETS * p->groups;
+    cl_int err;
+
+    err = clSetKernelArg(p->count, 0, sizeof(cl_mem), &in);
+    err |= clSetKernelArg(p->count, 1, sizeof(int), &n);
+    err |= clSetKernelArg(p->count, 2, sizeof(int), &pivot);
+    err |= clSetKernelArg(p->count, 3, sizeof(int), &shift);
+    err |= clSetKernelArg(p->count, 4, sizeof(cl_mem), &p->counts);
+    err |= clSetKernelArg(p->scan, 0, sizeof(cl_mem), &p->counts);
+    err |= clSetKernelArg(p->scan, 1, sizeof(int), &m);
+    err |= clSetKernelArg(p->scatter, 0, sizeof(cl_mem), &in);
+    err |= clSetKernelArg(p->scatter, 1, sizeof(cl_mem), &out);
+    err |= clSetKernelArg(p->scatter, 2, sizeof(int), &n);
+    err |= clSetKernelArg(p->scatter, 3, sizeof(int), &pivot);
+    err |= clSetKernelArg(p->scatter, 4, sizeof(int), &shift);
+    err |= clSetKernelArg(p->scatter, 5, sizeof(cl_mem), &p->counts);
+    if (err != CL_SUCCESS) return err;
+
+    // In-order queue: each kernel sees the previous one's results
+    err = clEnqueueNDRangeKernel(p->queue, p->count, 1, NULL, &global, &local, 0, NULL, NULL);
+    if (err == CL_SUCCESS)
+        err = clEnqueueNDRangeKernel(p->queue, p->scan, 1, NULL, &local, &local, 0, NULL, NULL);
+    if (err == CL_SUCCESS)
+        err = clEnqueueNDRangeKernel(p->queue, p->scatter, 1, NULL, &global, &local, 0, NULL, NULL);
+    return err;
+}
+
 void serial_quicksort(int* arr, int left, int right) {
     if (left >= right) return;
-    
+
     int pivot = arr[(left + right) / 2];
     int i = left, j = right;
-    
+
     while (i <= j) {
         while (arr[i] < pivot) i++;
         while (arr[j] > pivot) j--;
@@ -42,51 +176,65 @@ void serial_quicksort(int* arr, int left, int right) {
             j--;
         }
     }
-    
+
     serial_quicksort(arr, left, j);
     serial_quicksort(arr, i, right);
 }
 
 int main(int argc, char** argv) {
     int rank, size;
+    int n = ARRAY_SIZE;
+    int device_sort = 0;
+    enum rng_dist dist = RNG_UNIFORM;
+    unsigned long long seed = RNG_DEFAULT_SEED;
     int *data = NULL;
     int chunk_size;
     int *chunk;
+    int *counts_per_rank, *displs;
     double start, end;
 
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // Ensure N is divisible by size
-    if (N % size != 0) {
-        if (rank == 0) {
-            printf("Error: Array size (%d) must be divisible by number of processes (%d)\n", N, size);
-        }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--device-sort") == 0) device_sort = 1;
+        else if (strcmp(argv[i], "--dist") == 0 && i + 1 < argc && rng_parse_dist(argv[i + 1], &dist) == 0) i++;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else n = atoi(argv[i]);
+    }
+    if (n < 1) {
+        if (rank == 0)
+            printf("Usage: %s [N] [--device-sort] [--dist uniform|sorted|reverse|few-unique|zipf] [--seed S]\n",
+                   argv[0]);
         MPI_Finalize();
         return 1;
     }
 
-    chunk_size = N / size;
-    chunk = (int*)malloc(sizeof(int) * chunk_size);
+    // Chunk sizes differ by at most one so n need not divide evenly
+    counts_per_rank = (int*)malloc(sizeof(int) * size);
+    displs = (int*)malloc(sizeof(int) * size);
+    partition_counts(n, size, 1, counts_per_rank, displs);
+    chunk_size = counts_per_rank[rank];
+    chunk = (int*)malloc(sizeof(int) * (chunk_size + 1));
 
     if (rank == 0) {
-        data = (int*)malloc(sizeof(int) * N);
-        srand(time(NULL));
-        for (int i = 0; i < N; i++) {
-            data[i] = rand() % 100;
-        }
-        printf("Unsorted array (%d elements):\n", N);
-        for (int i = 0; i < N; i++) {
-            printf("%d ", data[i]);
+        data = (int*)malloc(sizeof(int) * n);
+        rng_spec spec = rng_make_spec(dist, seed, 0, 100);
+        rng_fill_ints(data, n, &spec);
+        if (n <= PRINT_LIMIT) {
+            printf("Unsorted array (%d elements):\n", n);
+            for (int i = 0; i < n; i++) {
+                printf("%d ", data[i]);
+            }
+            printf("\n");
         }
-        printf("\n");
     }
 
     start = MPI_Wtime();
 
     // Scatter chunks
-    MPI_Scatter(data, chunk_size, MPI_INT, chunk, chunk_size, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(data, counts_per_rank, displs, MPI_INT, chunk, chunk_size, MPI_INT, 0, MPI_COMM_WORLD);
 
     // Initialize OpenCL
     cl_platform_id platform_id;
@@ -94,9 +242,8 @@ int main(int argc, char** argv) {
     cl_context context;
     cl_command_queue queue;
     cl_program program;
-    cl_kernel kernel;
-    cl_mem d_chunk, d_out, d_counts;
-    size_t global_size = chunk_size;
+    cl_mem d_chunk, d_out;
+    bucket_pass pass;
     cl_int ret;
 
     ret = clGetPlatformIDs(1, &platform_id, NULL);
@@ -123,7 +270,9 @@ int main(int argc, char** argv) {
     context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
     queue = clCreateCommandQueueWithProperties(context, device_id, 0, &ret);
     program = clCreateProgramWithSource(context, 1, &kernelSource, NULL, &ret);
-    ret = clBuildProgram(program, 1, &device_id, NULL, NULL, NULL);
+    char options[128];
+    snprintf(options, sizeof(options), "-DLOCAL=%d -DPER_ITEM=%d -DBUCKETS=%d", LOCAL_SIZE, PER_ITEM, BUCKETS);
+    ret = clBuildProgram(program, 1, &device_id, options, NULL, NULL);
 
     if (ret != CL_SUCCESS) {
         size_t log_size;
@@ -136,63 +285,115 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
-    kernel = clCreateKernel(program, "partition_compact", &ret);
-
-    d_chunk = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(int) * chunk_size, NULL, &ret);
-    d_out = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(int) * chunk_size, NULL, &ret);
-    d_counts = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(int) * 3, NULL, &ret);
-
-    // Initialize counts to 0
-    int counts[3] = {0, 0, 0};
-    clEnqueueWriteBuffer(queue, d_counts, CL_TRUE, 0, sizeof(int) * 3, counts, 0, NULL, NULL);
-    clEnqueueWriteBuffer(queue, d_chunk, CL_TRUE, 0, sizeof(int) * chunk_size, chunk, 0, NULL, NULL);
+    pass.queue = queue;
+    pass.count = clCreateKernel(program, "bucket_count", &ret);
+    pass.scan = clCreateKernel(program, "scan_offsets", &ret);
+    pass.scatter = clCreateKernel(program, "bucket_scatter", &ret);
+    pass.groups = (chunk_size + TILE_SIZE - 1) / TILE_SIZE;
+    if (pass.groups == 0) pass.groups = 1;
 
-    // Choose pivot - better to use a global pivot but using local for simplicity
-    int pivot = chunk[chunk_size / 2];
+    d_chunk = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(int) * (chunk_size + 1), NULL, &ret);
+    d_out = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(int) * (chunk_size + 1), NULL, &ret);
+    pass.counts = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(int) * BUCKETS * pass.groups, NULL, &ret);
 
-    clSetKernelArg(kernel, 0, sizeof(cl_mem), &d_chunk);
-    clSetKernelArg(kernel, 1, sizeof(int), &pivot);
-    clSetKernelArg(kernel, 2, sizeof(cl_mem), &d_out);
-    clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_counts);
+    int* partitioned = (int*)malloc(sizeof(int) * (chunk_size + 1));
+    ret = CL_SUCCESS;
+    // With n < ranks some chunks are empty: zero-byte transfers fail with
+    // CL_INVALID_VALUE, and there is nothing to sort, so skip the device
+    if (chunk_size > 0) {
+        ret = clEnqueueWriteBuffer(queue, d_chunk, CL_TRUE, 0, sizeof(int) * chunk_size, chunk, 0, NULL, NULL);
+    }
+    if (chunk_size > 0 && ret == CL_SUCCESS) {
+        if (device_sort) {
+            // LSD radix sort: eight stable 4-bit passes, ping-ponging between the
+            // two buffers, so the sorted keys end up back in d_chunk
+            cl_mem src = d_chunk, dst = d_out;
+            for (int shift = 0; shift < 32 && ret == CL_SUCCESS; shift += RADIX_BITS) {
+                ret = run_bucket_pass(&pass, src, dst, chunk_size, 0, shift);
+                cl_mem t = src;
+                src = dst;
+                dst = t;
+            }
+            if (ret == CL_SUCCESS)
+                ret = clEnqueueReadBuffer(queue, src, CL_TRUE, 0, sizeof(int) * chunk_size, partitioned, 0, NULL, NULL);
+        } else {
+            // Choose pivot - better to use a global pivot but using local for simplicity
+            int pivot = chunk[chunk_size / 2];
+            int counts[3] = {0, 0, 0};
+            int bounds[2] = {0, 0};
+            ret = run_bucket_pass(&pass, d_chunk, d_out, chunk_size, pivot, -1);
 
-    ret = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global_size, NULL, 0, NULL, NULL);
+            // The scanned offsets of buckets 1 and 2 in group 0 are the sizes of
+            // the < pivot and <= pivot groups
+            if (ret == CL_SUCCESS)
+                ret = clEnqueueReadBuffer(queue, pass.counts, CL_TRUE, sizeof(int) * pass.groups, sizeof(int),
+                                          &bounds[0], 0, NULL, NULL);
+            if (ret == CL_SUCCESS)
+                ret = clEnqueueReadBuffer(queue, pass.counts, CL_TRUE, sizeof(int) * 2 * pass.groups, sizeof(int),
+                                          &bounds[1], 0, NULL, NULL);
+            if (ret == CL_SUCCESS)
+                ret = clEnqueueReadBuffer(queue, d_out, CL_TRUE, 0, sizeof(int) * chunk_size, partitioned, 0, NULL, NULL);
+            counts[0] = bounds[0];
+            counts[1] = bounds[1] - bounds[0];
+            counts[2] = chunk_size - bounds[1];
 
-    // Read back the results
-    int* partitioned = (int*)malloc(sizeof(int) * chunk_size);
-    clEnqueueReadBuffer(queue, d_out, CL_TRUE, 0, sizeof(int) * chunk_size, partitioned, 0, NULL, NULL);
-    clEnqueueReadBuffer(queue, d_counts, CL_TRUE, 0, sizeof(int) * 3, counts, 0, NULL, NULL);
+            // Sort the partitioned data
+            if (counts[0] > 1) serial_quicksort(partitioned, 0, counts[0] - 1); // Sort low part
+            if (counts[1] > 1) serial_quicksort(partitioned, counts[0], counts[0] + counts[1] - 1); // Sort equal part
+            if (counts[2] > 1) serial_quicksort(partitioned, counts[0] + counts[1], chunk_size - 1); // Sort high part
+        }
+    }
     clFinish(queue);
-
-    // Sort the partitioned data
-    if (counts[0] > 1) serial_quicksort(partitioned, 0, counts[0] - 1); // Sort low part
-    if (counts[1] > 1) serial_quicksort(partitioned, counts[0], counts[0] + counts[1] - 1); // Sort equal part
-    if (counts[2] > 1) serial_quicksort(partitioned, counts[0] + counts[1], chunk_size - 1); // Sort high part
+    if (ret != CL_SUCCESS) {
+        printf("Error: OpenCL sort failed on rank %d (%d)\n", rank, ret);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
     // Cleanup OpenCL
     clReleaseMemObject(d_chunk);
     clReleaseMemObject(d_out);
-    clReleaseMemObject(d_counts);
-    clReleaseKernel(kernel);
+    clReleaseMemObject(pass.counts);
+    clReleaseKernel(pass.count);
+    clReleaseKernel(pass.scan);
+    clReleaseKernel(pass.scatter);
     clReleaseProgram(program);
     clReleaseCommandQueue(queue);
     clReleaseContext(context);
 
     // Gather all sorted chunks
-    MPI_Gather(partitioned, chunk_size, MPI_INT, data, chunk_size, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(partitioned, chunk_size, MPI_INT, data, counts_per_rank, displs, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // Each chunk is sorted on its own; merge them into one sorted array
+    if (rank == 0) {
+        int *merged = (int*)malloc(sizeof(int) * n);
+        kway_merge_runs(data, counts_per_rank, displs, size, merged);
+        free(data);
+        data = merged;
+    }
 
     end = MPI_Wtime();
 
     if (rank == 0) {
-        printf("\nSorted array (%d elements):\n", N);
-        for (int i = 0; i < N; i++) {
-            printf("%d ", data[i]);
+        int sorted = 1;
+        for (int i = 1; i < n; i++) {
+            if (data[i - 1] > data[i]) sorted = 0;
+        }
+        if (n <= PRINT_LIMIT) {
+            printf("\nSorted array (%d elements):\n", n);
+            for (int i = 0; i < n; i++) {
+                printf("%d ", data[i]);
+            }
+            printf("\n");
         }
-        printf("\n");
+        printf("Mode: %s\n", device_sort ? "device radix sort" : "device partition + host quicksort");
+        printf("Sorted: %s\n", sorted ? "yes" : "NO");
         printf("Execution Time: %f seconds\n", end - start);
     }
 
     free(chunk);
     free(partitioned);
+    free(counts_per_rank);
+    free(displs);
     if (rank == 0) free(data);
 
     MPI_Finalize();
@@ -1,10 +1,23 @@
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
+#include "../common/kway_merge.h"
+#include "../common/mpi_partition.h"
+#include "../common/rng.h"
 
-#define ARRAY_SIZE 16         
+// Parallel sorting by regular sampling (PSRS): every rank sorts its own
+// chunk, the ranks agree on size - 1 splitters from a regular sample of the
+// sorted chunks, MPI_Alltoallv sends each key to the rank owning its splitter
+// interval, and each rank merges the runs it received. The result stays
+// distributed in rank order; --gather collects it on MASTER.
+//
+// Usage: mpi_quicksort [N] [--gather] [--dist D] [--seed S]
+// Build: mpicc mpi_quicksort.c -o mpi_quicksort -lm   (-lm for common/rng.h)
+
+#define ARRAY_SIZE 16
 #define MASTER 0
+#define PRINT_LIMIT 64         // arrays up to this size are printed
 
 void quicksort(int *arr, int left, int right) {
     int i = left, j = right;
@@ -27,81 +40,238 @@ void quicksort(int *arr, int left, int right) {
     if (i < right) quicksort(arr, i, right);
 }
 
-void merge(int *a, int size_a, int *b, int size_b, int *result) {
-    int i = 0, j = 0, k = 0;
+// Sample key tagged with its origin, so equal keys still have a total order
+// and long runs of duplicates can be split between ranks
+typedef struct {
+    int key;
+    int rank;
+    int index;
+} sample_t;
+
+int compare_samples(const void *a, const void *b) {
+    const sample_t *x = (const sample_t *)a, *y = (const sample_t *)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    if (x->rank != y->rank) return x->rank < y->rank ? -1 : 1;
+    return (x->index > y->index) - (x->index < y->index);
+}
 
-    while (i < size_a && j < size_b) {
-        if (a[i] < b[j]) result[k++] = a[i++];
-        else result[k++] = b[j++];
+// Number of elements of sorted arr[0..n) that are < key (or <= key)
+int bound(const int *arr, int n, int key, int inclusive) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (arr[mid] < key || (inclusive && arr[mid] == key)) lo = mid + 1;
+        else hi = mid;
     }
+    return lo;
+}
 
-    while (i < size_a) result[k++] = a[i++];
-    while (j < size_b) result[k++] = b[j++];
+// Number of this rank's sorted keys that order before or at splitter s
+int split_position(const int *arr, int n, sample_t s, int rank) {
+    if (rank < s.rank) return bound(arr, n, s.key, 1);
+    if (rank > s.rank) return bound(arr, n, s.key, 0);
+    return s.index + 1;
 }
 
 int main(int argc, char *argv[]) {
     int rank, size;
-    int *data = NULL;
+    int n = ARRAY_SIZE;
+    int gather = 0;
+    enum rng_dist dist = RNG_UNIFORM;
+    unsigned long long seed = RNG_DEFAULT_SEED;
     int *local_data;
     int chunk_size;
+    int *counts, *displs;
     double start_time, end_time;
 
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    chunk_size = ARRAY_SIZE / size;
-    local_data = (int *)malloc(chunk_size * sizeof(int));
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gather") == 0) gather = 1;
+        else if (strcmp(argv[i], "--dist") == 0 && i + 1 < argc && rng_parse_dist(argv[i + 1], &dist) == 0) i++;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else n = atoi(argv[i]);
+    }
+    if (n <= 0) {
+        if (rank == MASTER)
+            printf("Usage: %s [N] [--gather] [--dist uniform|sorted|reverse|few-unique|zipf] [--seed S]\n", argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
 
-    if (rank == MASTER) {
-        data = (int *)malloc(ARRAY_SIZE * sizeof(int));
-        srand(time(NULL));
+    // Chunk sizes differ by at most one so any N works with any rank count.
+    // Each rank generates its own chunk, so no rank ever holds all N keys;
+    // the generator is counter based, so the whole array is the same for a
+    // given seed whatever the number of ranks.
+    counts = (int *)malloc(size * sizeof(int));
+    displs = (int *)malloc(size * sizeof(int));
+    partition_counts(n, size, 1, counts, displs);
+    chunk_size = counts[rank];
+    local_data = (int *)malloc((chunk_size + 1) * sizeof(int));
 
-        printf("Original Array: ");
-        for (int i = 0; i < ARRAY_SIZE; i++) {
-            data[i] = rand() % 100;
-            printf("%d ", data[i]);
-        }
-        printf("\n");
+    rng_spec spec = rng_make_spec(dist, seed, 0, 100);
+    rng_fill_ints_at(local_data, (uint64_t)displs[rank], (size_t)chunk_size, (uint64_t)n, &spec);
 
-        start_time = MPI_Wtime();  // Start timing
+    if (n <= PRINT_LIMIT) {
+        int *data = rank == MASTER ? (int *)malloc(n * sizeof(int)) : NULL;
+        MPI_Gatherv(local_data, chunk_size, MPI_INT, data, counts, displs, MPI_INT, MASTER, MPI_COMM_WORLD);
+        if (rank == MASTER) {
+            printf("Original Array: ");
+            for (int i = 0; i < n; i++) printf("%d ", data[i]);
+            printf("\n");
+            free(data);
+        }
     }
 
-    MPI_Scatter(data, chunk_size, MPI_INT, local_data, chunk_size, MPI_INT, MASTER, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    start_time = MPI_Wtime();  // Start timing
 
-    quicksort(local_data, 0, chunk_size - 1);
+    // 1. Local sort
+    if (chunk_size > 0) quicksort(local_data, 0, chunk_size - 1);
 
-    int *sorted = NULL;
-    if (rank == MASTER) {
-        sorted = (int *)malloc(ARRAY_SIZE * sizeof(int));
+    // 2. Regular sample: up to size keys from every rank, shared with all
+    //    ranks
+    sample_t *samples = (sample_t *)malloc(size * sizeof(sample_t));
+    sample_t *all_samples = (sample_t *)malloc(size * size * sizeof(sample_t));
+    int *sample_counts = (int *)malloc(size * sizeof(int));
+    int *sample_displs = (int *)malloc(size * sizeof(int));
+    int my_samples = chunk_size < size ? chunk_size : size;
+    for (int i = 0; i < my_samples; i++) {
+        samples[i].index = (int)((long long)i * chunk_size / my_samples);
+        samples[i].key = local_data[samples[i].index];
+        samples[i].rank = rank;
     }
+    int my_sample_ints = 3 * my_samples;
+    MPI_Allgather(&my_sample_ints, 1, MPI_INT, sample_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    int total_samples = 0;
+    for (int r = 0; r < size; r++) {
+        sample_displs[r] = 3 * total_samples;
+        total_samples += sample_counts[r] / 3;
+    }
+    MPI_Allgatherv(samples, my_sample_ints, MPI_INT, all_samples, sample_counts, sample_displs, MPI_INT,
+                   MPI_COMM_WORLD);
 
-    MPI_Gather(local_data, chunk_size, MPI_INT, sorted, chunk_size, MPI_INT, MASTER, MPI_COMM_WORLD);
-
-    if (rank == MASTER) {
-        int *temp = sorted;
-        int *merged = (int *)malloc(ARRAY_SIZE * sizeof(int));
-        for (int i = chunk_size; i < ARRAY_SIZE; i += chunk_size) {
-            merge(temp, i, sorted + i, chunk_size, merged);
-            for (int j = 0; j < i + chunk_size; j++) temp[j] = merged[j];
+    // 3. Splitters at regular positions of the sorted sample; every rank
+    //    computes the same ones, so no broadcast is needed
+    qsort(all_samples, total_samples, sizeof(sample_t), compare_samples);
+    int *send_counts = (int *)malloc(size * sizeof(int));
+    int *send_displs = (int *)malloc(size * sizeof(int));
+    int prev = 0;
+    for (int r = 0; r < size; r++) {
+        int end = chunk_size;
+        if (r < size - 1 && total_samples > 0) {
+            // Samples sit at the i/size quantiles of every chunk, so the
+            // boundary after rank r is the middle of sample group r + 1
+            long long at = (long long)(r + 1) * total_samples / size + total_samples / (2 * size) - 1;
+            if (at < 0) at = 0;
+            if (at > total_samples - 1) at = total_samples - 1;
+            sample_t splitter = all_samples[at];
+            end = split_position(local_data, chunk_size, splitter, rank);
+            if (end < prev) end = prev;
         }
+        send_displs[r] = prev;
+        send_counts[r] = end - prev;
+        prev = end;
+    }
+
+    // 4. Exchange: rank r receives every key in its splitter interval
+    int *recv_counts = (int *)malloc(size * sizeof(int));
+    int *recv_displs = (int *)malloc(size * sizeof(int));
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    int local_n = 0;
+    for (int r = 0; r < size; r++) {
+        recv_displs[r] = local_n;
+        local_n += recv_counts[r];
+    }
+    int *received = (int *)malloc((local_n + 1) * sizeof(int));
+    MPI_Alltoallv(local_data, send_counts, send_displs, MPI_INT,
+                  received, recv_counts, recv_displs, MPI_INT, MPI_COMM_WORLD);
+
+    // 5. Merge the size sorted runs that arrived
+    int *sorted = (int *)malloc((local_n + 1) * sizeof(int));
+    kway_merge_runs(received, recv_counts, recv_displs, size, sorted);
+
+    end_time = MPI_Wtime();  // End timing
+    double elapsed = end_time - start_time, max_elapsed;
+    MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+
+    // Check: locally sorted, ordered across rank boundaries, nothing lost
+    int ok = 1;
+    for (int i = 1; i < local_n; i++)
+        if (sorted[i - 1] > sorted[i]) ok = 0;
+    int has_keys = local_n > 0;
+    int *firsts = (int *)malloc(size * sizeof(int));
+    int *lasts = (int *)malloc(size * sizeof(int));
+    int *nonempty = (int *)malloc(size * sizeof(int));
+    int first_key = has_keys ? sorted[0] : 0, last_key = has_keys ? sorted[local_n - 1] : 0;
+    MPI_Gather(&first_key, 1, MPI_INT, firsts, 1, MPI_INT, MASTER, MPI_COMM_WORLD);
+    MPI_Gather(&last_key, 1, MPI_INT, lasts, 1, MPI_INT, MASTER, MPI_COMM_WORLD);
+    MPI_Gather(&has_keys, 1, MPI_INT, nonempty, 1, MPI_INT, MASTER, MPI_COMM_WORLD);
+    int all_ok;
+    long long local_total = local_n, total;
+    MPI_Reduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&local_total, &total, 1, MPI_LONG_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
 
-        end_time = MPI_Wtime();  // End timing
+    int *final_counts = (int *)malloc(size * sizeof(int));
+    MPI_Gather(&local_n, 1, MPI_INT, final_counts, 1, MPI_INT, MASTER, MPI_COMM_WORLD);
 
-        printf("Sorted Array:   ");
-        for (int i = 0; i < ARRAY_SIZE; i++) {
-            printf("%d ", temp[i]);
+    if (rank == MASTER) {
+        int have_last = 0, last = 0;
+        for (int r = 0; r < size; r++) {
+            if (!nonempty[r]) continue;
+            if (have_last && last > firsts[r]) all_ok = 0;
+            last = lasts[r];
+            have_last = 1;
         }
-        printf("\n");
+        if (total != n) all_ok = 0;
 
-        printf("\n Execution Time (MPI only): %.6f seconds\n", end_time - start_time);
+        printf("Keys per rank:  ");
+        for (int r = 0; r < size; r++) printf("%d ", final_counts[r]);
+        printf("\n");
+        printf("Globally sorted: %s\n", all_ok ? "yes" : "NO");
+        printf("\n Execution Time (MPI only): %.6f seconds\n", max_elapsed);
+    }
 
-        free(data);
-        free(sorted);
-        free(merged);
+    // Optional: collect the distributed result on MASTER (already in order)
+    if (gather || n <= PRINT_LIMIT) {
+        int *result = NULL;
+        int *final_displs = (int *)malloc(size * sizeof(int));
+        if (rank == MASTER) {
+            result = (int *)malloc(n * sizeof(int));
+            for (int r = 0, d = 0; r < size; r++) {
+                final_displs[r] = d;
+                d += final_counts[r];
+            }
+        }
+        MPI_Gatherv(sorted, local_n, MPI_INT, result, final_counts, final_displs, MPI_INT, MASTER, MPI_COMM_WORLD);
+        if (rank == MASTER && n <= PRINT_LIMIT) {
+            printf("Sorted Array:   ");
+            for (int i = 0; i < n; i++) printf("%d ", result[i]);
+            printf("\n");
+        }
+        free(result);
+        free(final_displs);
     }
 
     free(local_data);
+    free(samples);
+    free(all_samples);
+    free(sample_counts);
+    free(sample_displs);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    free(received);
+    free(sorted);
+    free(firsts);
+    free(lasts);
+    free(nonempty);
+    free(final_counts);
+    free(counts);
+    free(displs);
     MPI_Finalize();
     return 0;
 }
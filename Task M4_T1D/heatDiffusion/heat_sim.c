@@ -1,6 +1,10 @@
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "../../common/mpi_partition.h"
+#include "../../common/matrix_io.h"
+#include "../../common/omp_schedule.h"
 
 #define GRID_SIZE 100
 #define MAX_STEPS 500
@@ -17,7 +21,7 @@ double** allocate_2d(int rows, int cols) {
     return array;
 }
 
-void initialize(double** grid, int local_rows, int cols, int rank, int size) {
+void initialize(double** grid, int local_rows, int cols, int start_row) {
     for (int i = 0; i < local_rows + 2; i++) {
         for (int j = 0; j < cols; j++) {
             grid[i][j] = INITIAL_TEMP;
@@ -25,7 +29,6 @@ void initialize(double** grid, int local_rows, int cols, int rank, int size) {
     }
 
     int global_center_row = GRID_SIZE / 2;
-    int start_row = rank * local_rows;
     int end_row = start_row + local_rows - 1;
 
     if (global_center_row >= start_row && global_center_row <= end_row) {
@@ -34,6 +37,28 @@ void initialize(double** grid, int local_rows, int cols, int rank, int size) {
     }
 }
 
+// Stencil update of local rows [begin, end) (grid rows begin + 1 .. end)
+typedef struct {
+    double** current;
+    double** next;
+    int cols;
+} stencil_args;
+
+void stencil_rows(long begin, long end, void* ctx) {
+    stencil_args* args = (stencil_args*)ctx;
+    double** current = args->current;
+    double** next = args->next;
+    for (int i = (int)begin + 1; i <= (int)end; i++) {
+        for (int j = 1; j < args->cols - 1; j++) {
+            next[i][j] = current[i][j] + ALPHA * (
+                current[i + 1][j] + current[i - 1][j] +
+                current[i][j + 1] + current[i][j - 1] -
+                4 * current[i][j]
+            );
+        }
+    }
+}
+
 int main(int argc, char* argv[]) {
     int rank, size;
     int rows = GRID_SIZE;
@@ -43,18 +68,27 @@ int main(int argc, char* argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    if (rows % size != 0) {
-        if (rank == MASTER)
-            printf("Grid rows not divisible by number of processes.\n");
-        MPI_Finalize();
-        return -1;
-    }
-
-    int local_rows = rows / size;
+    // --report prints the master's per-thread busy time for the last step
+    int report = 0;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--report") == 0) report = 1;
+
+    // Rows are split as evenly as possible, so any process count works
+    int* counts = (int*)malloc(size * sizeof(int));
+    int* displs = (int*)malloc(size * sizeof(int));
+    partition_counts(rows, size, cols, counts, displs);
+    int local_rows = partition_count(rows, size, rank);
+    int start_row = partition_start(rows, size, rank);
     double** current = allocate_2d(local_rows + 2, cols);
     double** next = allocate_2d(local_rows + 2, cols);
 
-    initialize(current, local_rows, cols, rank, size);
+    initialize(current, local_rows, cols, start_row);
+
+    // Rows are split over OpenMP threads when built with -fopenmp; every row
+    // costs the same, so static by default (LOOP_SCHEDULE overrides)
+    sched_loop loop;
+    sched_loop_init(&loop, SCHED_STATIC, 0, 0);
+    sched_loop_env(&loop);
 
     double start_time = MPI_Wtime();
 
@@ -68,19 +102,11 @@ int main(int argc, char* argv[]) {
             MPI_Recv(current[local_rows + 1], cols, MPI_DOUBLE, rank + 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         }
 
-        for (int i = 1; i <= local_rows; i++) {
-            for (int j = 1; j < cols - 1; j++) {
-                next[i][j] = current[i][j] + ALPHA * (
-                    current[i + 1][j] + current[i - 1][j] +
-                    current[i][j + 1] + current[i][j - 1] -
-                    4 * current[i][j]
-                );
-            }
-        }
+        stencil_args args = {current, next, cols};
+        sched_run(&loop, local_rows, stencil_rows, &args);
 
         // Reapply heat source every step
         int global_center_row = GRID_SIZE / 2;
-        int start_row = rank * local_rows;
         int end_row = start_row + local_rows - 1;
 
         if (global_center_row >= start_row && global_center_row <= end_row) {
@@ -109,26 +135,20 @@ int main(int argc, char* argv[]) {
         full_grid = (double*)malloc(rows * cols * sizeof(double));
     }
 
-    MPI_Gather(local_data, local_rows * cols, MPI_DOUBLE,
-               full_grid, local_rows * cols, MPI_DOUBLE,
-               MASTER, MPI_COMM_WORLD);
+    MPI_Gatherv(local_data, local_rows * cols, MPI_DOUBLE,
+                full_grid, counts, displs, MPI_DOUBLE,
+                MASTER, MPI_COMM_WORLD);
 
     if (rank == MASTER) {
-        FILE* fp = fopen("output.txt", "w");
-        if (!fp) {
-            printf("Failed to write output.txt\n");
+        // Binary grid (common/matrix_io.h): one write, no text formatting.
+        // plot_heatmap.py reads it directly; tools/matrix2txt gives text.
+        if (matrix_write("output.bin", MATRIX_FLOAT64, rows, cols, full_grid, 0) != 0) {
+            printf("Failed to write output.bin\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
-
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                fprintf(fp, "%.2f ", full_grid[i * cols + j]);
-            }
-            fprintf(fp, "\n");
-        }
-        fclose(fp);
-        printf("Output written to output.txt\n");
+        printf("Output written to output.bin\n");
         printf("Max execution time: %.6f seconds\n", max_elapsed);
+        if (report) sched_report(&loop, stdout);
         free(full_grid);
     }
 
@@ -136,6 +156,9 @@ int main(int argc, char* argv[]) {
     free(current);
     free(next[0]);
     free(next);
+    free(counts);
+    free(displs);
+    sched_loop_free(&loop);
 
     MPI_Finalize();
     return 0;
@@ -1,12 +1,29 @@
+import sys
 import numpy as np
 import matplotlib.pyplot as plt
 
-def plot_heatmap(filename="output.txt"):
-    data = np.loadtxt(filename)
+# Binary matrix files from common/matrix_io.h: 64-byte header, then the data
+MATRIX_DTYPES = {1: np.int32, 2: np.float32, 3: np.float64}
+
+def load_matrix(filename):
+    if not filename.endswith(".bin"):
+        return np.loadtxt(filename)
+    header = np.fromfile(filename, dtype=np.uint8, count=64)
+    if header[:4].tobytes() != b"SMAT":
+        raise ValueError(f"{filename} is not a matrix file")
+    # The endianness marker tells which byte order the writer used
+    order = "<" if header[12:16].view("<u4")[0] == 0x01020304 else ">"
+    _, dtype, _ = header[4:16].view(order + "u4")
+    rows, cols, offset = header[16:40].view(order + "u8")
+    element = np.dtype(MATRIX_DTYPES[int(dtype)]).newbyteorder(order)
+    return np.memmap(filename, dtype=element, mode="r", offset=int(offset), shape=(int(rows), int(cols)))
+
+def plot_heatmap(filename="output.bin"):
+    data = load_matrix(filename)
     plt.imshow(data, cmap='hot', interpolation='nearest')
     plt.colorbar(label='Temperature (°C)')
     plt.title("Heat Diffusion Final State")
     plt.show()
 
 if __name__ == "__main__":
-    plot_heatmap()
+    plot_heatmap(*sys.argv[1:2])
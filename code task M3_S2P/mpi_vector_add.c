@@ -1,6 +1,7 @@
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "../common/mpi_partition.h"
 
 int main(int argc, char* argv[]) {
     int rank, size;
@@ -12,7 +13,11 @@ int main(int argc, char* argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    int local_n = n / size;
+    // Chunk sizes differ by at most one, so n need not divide evenly
+    int *counts = (int*)malloc(size * sizeof(int));
+    int *displs = (int*)malloc(size * sizeof(int));
+    partition_counts(n, size, 1, counts, displs);
+    int local_n = counts[rank];
 
     local_v1 = (int*)malloc(local_n * sizeof(int));
     local_v2 = (int*)malloc(local_n * sizeof(int));
@@ -29,20 +34,18 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    MPI_Scatter(v1, local_n, MPI_INT, local_v1, local_n, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Scatter(v2, local_n, MPI_INT, local_v2, local_n, MPI_INT, 0, MPI_COMM_WORLD);
-
-    for (int i = 0; i < local_n; i++) {
-        local_v3[i] = local_v1[i] + local_v2[i];
-    }
-
-    MPI_Gather(local_v3, local_n, MPI_INT, v3, local_n, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(v1, counts, displs, MPI_INT, local_v1, local_n, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(v2, counts, displs, MPI_INT, local_v2, local_n, MPI_INT, 0, MPI_COMM_WORLD);
 
+    // Add and sum in the same pass, so local_v3 is not read back a second time
     int local_sum = 0, total_sum = 0;
     for (int i = 0; i < local_n; i++) {
+        local_v3[i] = local_v1[i] + local_v2[i];
         local_sum += local_v3[i];
     }
 
+    MPI_Gatherv(local_v3, local_n, MPI_INT, v3, counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
+
     MPI_Reduce(&local_sum, &total_sum, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
 
     if (rank == 0) {
@@ -56,6 +59,7 @@ int main(int argc, char* argv[]) {
     }
 
     free(local_v1); free(local_v2); free(local_v3);
+    free(counts); free(displs);
     MPI_Finalize();
     return 0;
 }
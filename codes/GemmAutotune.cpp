@@ -0,0 +1,172 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../common/gemm_parallel.h"
+#include "../common/gemm_tuning.h"
+#include "../common/rng.h"
+
+// Benchmarks GEMM block sizes, thread counts and backends for one shape on
+// this machine and stores the fastest configuration of each backend in the
+// tuning cache, which the matrix programs read at startup.
+//
+// Usage: GemmAutotune [--m M] [--n N] [--k K] [--dtype int|float]
+//                     [--max-threads T] [--cache FILE]
+
+using namespace std;
+using namespace std::chrono;
+
+struct Result {
+    gemm::TuningEntry entry;
+    double seconds;
+};
+
+// Best of a few timed runs after one warm-up run
+template <typename F>
+double timeRuns(F&& run) {
+    run();
+    double best = 1e30;
+    for (int r = 0; r < 3; r++) {
+        auto start = high_resolution_clock::now();
+        run();
+        auto stop = high_resolution_clock::now();
+        best = min(best, duration<double>(stop - start).count());
+    }
+    return best;
+}
+
+// Values 0-4 from the counter-based generator (common/rng.h)
+template <typename T>
+void fillRandom(Matrix<T>& matrix, uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 5);
+    const uint64_t total = uint64_t(matrix.rows()) * matrix.cols();
+    #pragma omp parallel for
+    for (int i = 0; i < matrix.rows(); i++)
+        for (int j = 0; j < matrix.cols(); j++)
+            matrix(i, j) = T(rng_int_at(&spec, uint64_t(i) * matrix.cols() + j, total));
+}
+
+template <typename T>
+vector<Result> tune(int m, int n, int k, const string& dtype, int maxThreads) {
+    Matrix<T> A(m, k), B(k, n), C(m, n);
+    fillRandom(A, RNG_DEFAULT_SEED);
+    fillRandom(B, RNG_DEFAULT_SEED + 1);
+    const double flops = 2.0 * m * n * k;
+
+    auto record = [&](const string& backend, const gemm::BlockSizes& bs, int threads, double seconds) {
+        Result r;
+        r.entry.m = m;
+        r.entry.n = n;
+        r.entry.k = k;
+        r.entry.dtype = dtype;
+        r.entry.backend = backend;
+        r.entry.blocks = bs;
+        r.entry.threads = threads;
+        r.entry.gflops = flops / seconds / 1e9;
+        r.seconds = seconds;
+        cout << "  " << setw(10) << left << backend << right
+             << " mc=" << setw(3) << bs.mc << " kc=" << setw(3) << bs.kc << " nc=" << setw(4) << bs.nc
+             << " threads=" << setw(3) << threads << "  " << fixed << setprecision(2)
+             << r.entry.gflops << " GFLOP/s" << endl;
+        return r;
+    };
+
+    // Phase 1: cache blocking on a single thread
+    cout << "Block sizes (sequential):" << endl;
+    Result bestSeq;
+    bestSeq.seconds = 1e30;
+    for (int mc : {64, 128, 256}) {
+        for (int kc : {128, 256, 512}) {
+            for (int nc : {1024, 4096}) {
+                gemm::BlockSizes bs;
+                bs.mc = mc;
+                bs.kc = kc;
+                bs.nc = nc;
+                double s = timeRuns([&] { gemm::multiplyRows(A, B, C, 0, m, bs); });
+                Result r = record("sequential", bs, 1, s);
+                if (r.seconds < bestSeq.seconds) bestSeq = r;
+            }
+        }
+    }
+
+    // Phase 2: thread counts for the parallel backends, starting from the
+    // best sequential blocks and also a smaller MC for more parallel slack
+    vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+    gemm::BlockSizes narrow = bestSeq.entry.blocks;
+    narrow.mc = 64;
+    vector<gemm::BlockSizes> parallelBlocks = {bestSeq.entry.blocks};
+    if (narrow.mc != bestSeq.entry.blocks.mc) parallelBlocks.push_back(narrow);
+
+    Result bestPool, bestOmp;
+    bestPool.seconds = bestOmp.seconds = 1e30;
+    cout << "Threads and backends:" << endl;
+    for (int threads : threadCounts) {
+        ThreadPool pool(threads);
+        for (const auto& bs : parallelBlocks) {
+            double s = timeRuns([&] { gemm::multiplyPool(pool, A, B, C, bs); });
+            Result r = record("pthread", bs, threads, s);
+            if (r.seconds < bestPool.seconds) bestPool = r;
+
+            s = timeRuns([&] { gemm::multiplyOpenMP(A, B, C, threads, bs); });
+            r = record("openmp", bs, threads, s);
+            if (r.seconds < bestOmp.seconds) bestOmp = r;
+        }
+    }
+    return {bestSeq, bestPool, bestOmp};
+}
+
+int main(int argc, char* argv[]) {
+    int m = 1024, n = 1024, k = 1024;
+    int maxThreads = ThreadPool::onlineCpus();
+    string dtype = "int";
+    string cachePath = gemm::tuningCachePath();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--m") == 0 && i + 1 < argc) m = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) n = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--k") == 0 && i + 1 < argc) k = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--dtype") == 0 && i + 1 < argc) dtype = argv[++i];
+        else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) maxThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) cachePath = argv[++i];
+        else {
+            cerr << "Usage: " << argv[0] << " [--m M] [--n N] [--k K] [--dtype int|float]"
+                 << " [--max-threads T] [--cache FILE]" << endl;
+            return 1;
+        }
+    }
+    if (m <= 0 || n <= 0 || k <= 0 || maxThreads <= 0 || (dtype != "int" && dtype != "float")) {
+        cerr << "Invalid shape, thread count or dtype" << endl;
+        return 1;
+    }
+
+    cout << "Tuning " << m << "x" << n << "x" << k << " " << dtype << " GEMM ("
+         << gemm::isaName(dtype == "int" ? gemm::selectedIsa<int>() : gemm::selectedIsa<float>())
+         << " kernel, up to " << maxThreads << " threads)" << endl;
+
+    vector<Result> winners = dtype == "int" ? tune<int>(m, n, k, dtype, maxThreads)
+                                            : tune<float>(m, n, k, dtype, maxThreads);
+
+    gemm::TuningCache cache;
+    cache.load(cachePath);
+    const Result* overall = &winners[0];
+    cout << "Winners:" << endl;
+    for (const auto& r : winners) {
+        cache.update(r.entry);
+        if (r.seconds < overall->seconds) overall = &r;
+        cout << "  " << r.entry.backend << ": " << fixed << setprecision(2) << r.entry.gflops
+             << " GFLOP/s (mc=" << r.entry.blocks.mc << " kc=" << r.entry.blocks.kc << " nc=" << r.entry.blocks.nc
+             << ", " << r.entry.threads << " threads)" << endl;
+    }
+    cout << "Fastest backend: " << overall->entry.backend << endl;
+
+    if (!cache.save(cachePath)) {
+        cerr << "Could not write tuning cache " << cachePath << endl;
+        return 1;
+    }
+    cout << "Saved to " << cachePath << endl;
+    return 0;
+}
@@ -1,64 +1,149 @@
 #include <iostream>
-#include <vector>
 #include <cstdlib>
 #include <ctime>
-#include <fstream>
+#include <memory>
+#include <stdexcept>
 #include <chrono>
 #include <omp.h>
+#include <cstring>
+#include "../common/gemm_parallel.h"
+#include "../common/gemm_tuning.h"
+#include "../common/matrix_io.h"
+#include "../common/omp_schedule.h"
+#include "../common/rng.h"
+#include "../common/strassen.h"
 
 using namespace std;
 using namespace std::chrono;
 
-const int N = 100; // Matrix size
-const int NUM_THREADS = 4; // Number of threads
+int N = 100; // Matrix size (--n)
 
-vector<vector<int>> A(N, vector<int>(N));
-vector<vector<int>> B(N, vector<int>(N));
-vector<vector<int>> C(N, vector<int>(N, 0));
+Matrix<int> A;
+Matrix<int> B;
+Matrix<int> C;
 
-// Function to generate a random matrix
-void generateMatrix(vector<vector<int>>& matrix) {
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            matrix[i][j] = rand() % 5; // Random values between 0-4
-        }
-    }
+// Function to generate a random matrix: values 0-4 from the counter-based
+// generator in common/rng.h, so a seed always gives the same matrix
+void generateMatrix(Matrix<int>& matrix, uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 5);
+    rng_fill_ints_2d(matrix.data(), matrix.rows(), matrix.cols(), matrix.stride(), &spec);
 }
 
-// Function to write matrix to a file
-void writeMatrixToFile(const vector<vector<int>>& matrix, const string& filename) {
-    ofstream file(filename);
-    for (const auto& row : matrix) {
-        for (int val : row) {
-            file << val << " ";
-        }
-        file << "\n";
-    }
-    file.close();
+// Function to write matrix to a binary file (tools/matrix2txt converts it to text)
+void writeMatrixToFile(const Matrix<int>& matrix, const string& filename) {
+    if (!saveMatrix(matrix, filename)) cerr << "Could not write " << filename << endl;
 }
 
-int main() {
-    srand(time(0));
-    generateMatrix(A);
-    generateMatrix(B);
+int main(int argc, char* argv[]) {
+    int num_threads = 0; // 0 = tuned value, else one per core
+    string fileA, fileB; // binary input matrices (common/matrix_io.h)
+    uint64_t seed = RNG_DEFAULT_SEED; // for generated inputs
+    bool use_strassen = false;
+    int strassen_cutoff = 512;
+    sched_kind schedule = SCHED_DYNAMIC; // over MC-row blocks (--schedule)
+    long chunk = 0;
+    bool report = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) N = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--a") == 0 && i + 1 < argc) fileA = argv[++i];
+        else if (strcmp(argv[i], "--b") == 0 && i + 1 < argc) fileB = argv[++i];
+        else if (strcmp(argv[i], "--strassen") == 0) use_strassen = true;
+        else if (strcmp(argv[i], "--cutoff") == 0 && i + 1 < argc) strassen_cutoff = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) num_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--schedule") == 0 && i + 1 < argc) {
+            if (sched_parse(argv[++i], &schedule, &chunk) != 0) {
+                cerr << "Unknown schedule " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--report") == 0) report = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--n N] [--a A.bin --b B.bin | --seed S] [--threads T] [--strassen [--cutoff C]]"
+                 << " [--schedule static|dynamic|guided|runtime|adaptive[,CHUNK]] [--report]" << endl;
+            return 1;
+        }
+    }
+    if (fileA.empty() != fileB.empty()) {
+        cerr << "--a and --b must be given together" << endl;
+        return 1;
+    }
+    
+    // Inputs are mapped straight from binary files (no parsing or copying),
+    // or generated when no files are given
+    unique_ptr<MappedMatrix<int>> mappedA, mappedB;
+    if (!fileA.empty()) {
+        try {
+            mappedA.reset(new MappedMatrix<int>(fileA));
+            mappedB.reset(new MappedMatrix<int>(fileB));
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        if (mappedA->cols() != mappedB->rows()) {
+            cerr << "Cannot multiply " << mappedA->rows() << "x" << mappedA->cols() << " by "
+                 << mappedB->rows() << "x" << mappedB->cols() << endl;
+            return 1;
+        }
+        A = mappedA->view();
+        B = mappedB->view();
+    } else {
+        A = Matrix<int>(N, N);
+        B = Matrix<int>(N, N);
+        generateMatrix(A, seed);
+        generateMatrix(B, seed + 1);
+    }
+    
+    // Block sizes and thread count from the tuning cache written by GemmAutotune
+    gemm::BlockSizes bs;
+    gemm::TuningCache cache;
+    cache.load();
+    if (const gemm::TuningEntry* tuned = cache.lookup(A.rows(), B.cols(), A.cols(), "int", "openmp")) {
+        bs = tuned->blocks;
+        if (num_threads <= 0) num_threads = tuned->threads;
+        cout << "Tuned: mc=" << bs.mc << " kc=" << bs.kc << " nc=" << bs.nc << " threads=" << tuned->threads << endl;
+    }
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+    
+    C = Matrix<int>(A.rows(), B.cols());
+    
+    // Strassen-Winograd scratch is allocated once, outside the timed region
+    gemm::StrassenOptions strassen;
+    gemm::StrassenArena<int> arena;
+    if (use_strassen) {
+        strassen.cutoff = strassen_cutoff;
+        strassen.blocks = bs;
+        strassen.threads = num_threads;
+        arena.reserve(gemm::strassenScratchSize(A.rows(), strassen));
+        cout << "Strassen-Winograd above " << strassen.cutoff << "x" << strassen.cutoff << endl;
+    }
+    
+    sched_loop loop;
+    sched_loop_init(&loop, schedule, chunk, num_threads);
+    sched_loop_env(&loop);
+    
+    // Resolve the SIMD kernel (CPUID + self-check) before timing starts
+    cout << "GEMM kernel: " << gemm::isaName(gemm::selectedIsa<int>()) << endl;
     
     auto start = high_resolution_clock::now();
     
-    #pragma omp parallel for num_threads(NUM_THREADS)
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            for (int k = 0; k < N; k++) {
-                C[i][j] += A[i][k] * B[k][j];
-            }
-        }
+    if (use_strassen) {
+        // The seven sub-products of the top level run as OpenMP tasks
+        gemm::multiplyStrassen(A, B, C, strassen, arena);
+    } else {
+        // Row blocks of up to MC rows, at least one per thread, so packed
+        // panels are reused
+        gemm::multiplyScheduled(A, B, C, loop, bs);
     }
     
     auto stop = high_resolution_clock::now();
     
     auto duration = duration_cast<milliseconds>(stop - start);
     cout << "Execution time: " << duration.count() << " ms" << endl;
+    if (report && !use_strassen) sched_report(&loop, stdout);
+    sched_loop_free(&loop);
     
-    writeMatrixToFile(C, "output_matrix_openmp.txt");
+    writeMatrixToFile(C, "output_matrix_openmp.bin");
     
     return 0;
 }
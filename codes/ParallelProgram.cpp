@@ -1,91 +1,119 @@
 #include <iostream>
-#include <vector>
 #include <cstdlib>
 #include <ctime>
-#include <fstream>
+#include <memory>
+#include <stdexcept>
 #include <pthread.h>
 #include <chrono>
+#include <cstring>
+#include "../common/gemm_parallel.h"
+#include "../common/gemm_tuning.h"
+#include "../common/matrix_io.h"
+#include "../common/rng.h"
 
 using namespace std;
 using namespace std::chrono;
 
-const int N = 100; // Matrix size
-const int NUM_THREADS = 4; // Number of threads
+int N = 100; // Matrix size (--n)
 
-vector<vector<int>> A(N, vector<int>(N));
-vector<vector<int>> B(N, vector<int>(N));
-vector<vector<int>> C(N, vector<int>(N, 0));
+Matrix<int> A;
+Matrix<int> B;
+Matrix<int> C;
 
-// Function to generate a random matrix
-void generateMatrix(vector<vector<int>>& matrix) {
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            matrix[i][j] = rand() % 5; // Random values between 0-4
-        }
-    }
+// Function to generate a random matrix: values 0-4 from the counter-based
+// generator in common/rng.h, so a seed always gives the same matrix
+void generateMatrix(Matrix<int>& matrix, uint64_t seed) {
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 5);
+    rng_fill_ints_2d(matrix.data(), matrix.rows(), matrix.cols(), matrix.stride(), &spec);
 }
 
-// Structure to pass multiple arguments to thread function
-struct ThreadData {
-    int thread_id;
-};
+// Function to write matrix to a binary file (tools/matrix2txt converts it to text)
+void writeMatrixToFile(const Matrix<int>& matrix, const string& filename) {
+    if (!saveMatrix(matrix, filename)) cerr << "Could not write " << filename << endl;
+}
 
-// Thread function for matrix multiplication
-void* multiplyRows(void* arg) {
-    ThreadData* data = (ThreadData*)arg;
-    int thread_id = data->thread_id;
-    
-    int rows_per_thread = N / NUM_THREADS;
-    int start_row = thread_id * rows_per_thread;
-    int end_row = (thread_id == NUM_THREADS - 1) ? N : start_row + rows_per_thread;
-    
-    for (int i = start_row; i < end_row; i++) {
-        for (int j = 0; j < N; j++) {
-            for (int k = 0; k < N; k++) {
-                C[i][j] += A[i][k] * B[k][j];
-            }
+int main(int argc, char* argv[]) {
+    int num_threads = 0; // 0 = one per online CPU
+    bool pin_threads = false;
+    int runs = 1;
+    string fileA, fileB; // binary input matrices (common/matrix_io.h)
+    uint64_t seed = RNG_DEFAULT_SEED; // for generated inputs
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) N = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--a") == 0 && i + 1 < argc) fileA = argv[++i];
+        else if (strcmp(argv[i], "--b") == 0 && i + 1 < argc) fileB = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) num_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--pin") == 0) pin_threads = true;
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = max(1, atoi(argv[++i]));
+        else {
+            cerr << "Usage: " << argv[0] << " [--n N] [--a A.bin --b B.bin | --seed S] [--threads T] [--pin] [--runs R]" << endl;
+            return 1;
         }
     }
-    pthread_exit(nullptr);
-}
-
-// Function to write matrix to a file
-void writeMatrixToFile(const vector<vector<int>>& matrix, const string& filename) {
-    ofstream file(filename);
-    for (const auto& row : matrix) {
-        for (int val : row) {
-            file << val << " ";
+    if (fileA.empty() != fileB.empty()) {
+        cerr << "--a and --b must be given together" << endl;
+        return 1;
+    }
+    
+    // Inputs are mapped straight from binary files (no parsing or copying),
+    // or generated when no files are given
+    unique_ptr<MappedMatrix<int>> mappedA, mappedB;
+    if (!fileA.empty()) {
+        try {
+            mappedA.reset(new MappedMatrix<int>(fileA));
+            mappedB.reset(new MappedMatrix<int>(fileB));
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
         }
-        file << "\n";
+        if (mappedA->cols() != mappedB->rows()) {
+            cerr << "Cannot multiply " << mappedA->rows() << "x" << mappedA->cols() << " by "
+                 << mappedB->rows() << "x" << mappedB->cols() << endl;
+            return 1;
+        }
+        A = mappedA->view();
+        B = mappedB->view();
+    } else {
+        A = Matrix<int>(N, N);
+        B = Matrix<int>(N, N);
+        generateMatrix(A, seed);
+        generateMatrix(B, seed + 1);
     }
-    file.close();
-}
-
-int main() {
-    srand(time(0));
-    generateMatrix(A);
-    generateMatrix(B);
     
-    pthread_t threads[NUM_THREADS];
-    ThreadData thread_data[NUM_THREADS];
+    // Block sizes and thread count from the tuning cache written by GemmAutotune
+    gemm::BlockSizes bs;
+    gemm::TuningCache cache;
+    cache.load();
+    if (const gemm::TuningEntry* tuned = cache.lookup(A.rows(), B.cols(), A.cols(), "int", "pthread")) {
+        bs = tuned->blocks;
+        if (num_threads <= 0) num_threads = tuned->threads;
+        cout << "Tuned: mc=" << bs.mc << " kc=" << bs.kc << " nc=" << bs.nc << " threads=" << tuned->threads << endl;
+    }
     
-    auto start = high_resolution_clock::now();
+    C = Matrix<int>(A.rows(), B.cols());
     
-    for (int i = 0; i < NUM_THREADS; i++) {
-        thread_data[i].thread_id = i;
-        pthread_create(&threads[i], nullptr, multiplyRows, (void*)&thread_data[i]);
-    }
+    // Resolve the SIMD kernel (CPUID + self-check) before timing starts
+    cout << "GEMM kernel: " << gemm::isaName(gemm::selectedIsa<int>()) << endl;
+    
+    // Workers are created once and reused for every multiply
+    ThreadPool pool(num_threads, pin_threads);
+    cout << "Worker threads: " << pool.size() << (pin_threads ? " (pinned)" : "") << endl;
+    
+    auto start = high_resolution_clock::now();
     
-    for (int i = 0; i < NUM_THREADS; i++) {
-        pthread_join(threads[i], nullptr);
+    for (int r = 0; r < runs; r++) {
+        // C is cut into 2-D tiles, several per worker, that workers take
+        // from their own deques and steal from each other when they run dry
+        gemm::multiplyPool(pool, A, B, C, bs);
     }
     
     auto stop = high_resolution_clock::now();
     
     auto duration = duration_cast<milliseconds>(stop - start);
-    cout << "Execution time: " << duration.count() << " ms" << endl;
+    cout << "Execution time: " << duration.count() / runs << " ms" << (runs > 1 ? " per multiply" : "") << endl;
     
-    writeMatrixToFile(C, "output_matrix_parallel.txt");
+    writeMatrixToFile(C, "output_matrix_parallel.bin");
     
     return 0;
 }
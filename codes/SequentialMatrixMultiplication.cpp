@@ -1,64 +1,123 @@
 #include <iostream>
-#include <vector>
 #include <cstdlib>
 #include <ctime>
-#include <fstream>
+#include <memory>
+#include <stdexcept>
 #include <chrono>
+#include <cstring>
+#include "../common/matrix.h"
+#include "../common/gemm_tuning.h"
+#include "../common/matrix_io.h"
+#include "../common/rng.h"
+#include "../common/strassen.h"
 
 using namespace std;
 using namespace std::chrono;
 
-// Function to generate a random matrix
-vector<vector<int>> generateMatrix(int N) {
-    vector<vector<int>> matrix(N, vector<int>(N));
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            matrix[i][j] = rand() % 5; // Random values between 0-9
-        }
-    }
+// Function to generate a random matrix: values 0-4 from the counter-based
+// generator in common/rng.h, so a seed always gives the same matrix
+Matrix<int> generateMatrix(int N, uint64_t seed) {
+    Matrix<int> matrix(N, N);
+    rng_spec spec = rng_make_spec(RNG_UNIFORM, seed, 0, 5);
+    rng_fill_ints_2d(matrix.data(), N, N, matrix.stride(), &spec);
     return matrix;
 }
 
-// Function for matrix multiplication
-vector<vector<int>> multiplyMatrices(const vector<vector<int>>& A, const vector<vector<int>>& B, int N) {
-    vector<vector<int>> C(N, vector<int>(N, 0));
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            for (int k = 0; k < N; k++) {
-                C[i][j] += A[i][k] * B[k][j];
-            }
-        }
-    }
+// Function for matrix multiplication (cache-blocked kernel from common/matrix.h)
+Matrix<int> multiplyMatrices(const Matrix<int>& A, const Matrix<int>& B, const gemm::BlockSizes& bs) {
+    return gemm::multiply(A, B, bs);
+}
+
+// Strassen-Winograd variant (common/strassen.h), classical kernel below the cutoff
+Matrix<int> multiplyMatricesStrassen(const Matrix<int>& A, const Matrix<int>& B,
+                                     const gemm::StrassenOptions& opt, gemm::StrassenArena<int>& arena) {
+    Matrix<int> C(A.rows(), B.cols());
+    gemm::multiplyStrassen(A, B, C, opt, arena);
     return C;
 }
 
-// Function to write matrix to a file
-void writeMatrixToFile(const vector<vector<int>>& matrix, const string& filename) {
-    ofstream file(filename);
-    for (const auto& row : matrix) {
-        for (int val : row) {
-            file << val << " ";
-        }
-        file << "\n";
-    }
-    file.close();
+// Function to write matrix to a binary file (tools/matrix2txt converts it to text)
+void writeMatrixToFile(const Matrix<int>& matrix, const string& filename) {
+    if (!saveMatrix(matrix, filename)) cerr << "Could not write " << filename << endl;
 }
 
-int main() {
-    srand(time(0));
+int main(int argc, char* argv[]) {
     int N = 100; // Matrix size
+    string fileA, fileB; // binary input matrices (common/matrix_io.h)
+    uint64_t seed = RNG_DEFAULT_SEED; // for generated inputs
+    bool use_strassen = false;
+    int strassen_cutoff = 512;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) N = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--a") == 0 && i + 1 < argc) fileA = argv[++i];
+        else if (strcmp(argv[i], "--b") == 0 && i + 1 < argc) fileB = argv[++i];
+        else if (strcmp(argv[i], "--strassen") == 0) use_strassen = true;
+        else if (strcmp(argv[i], "--cutoff") == 0 && i + 1 < argc) strassen_cutoff = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        else {
+            cerr << "Usage: " << argv[0] << " [--n N] [--a A.bin --b B.bin | --seed S] [--strassen [--cutoff C]]" << endl;
+            return 1;
+        }
+    }
+    if (fileA.empty() != fileB.empty()) {
+        cerr << "--a and --b must be given together" << endl;
+        return 1;
+    }
+    
+    // Inputs are mapped straight from binary files (no parsing or copying),
+    // or generated when no files are given
+    Matrix<int> A, B;
+    unique_ptr<MappedMatrix<int>> mappedA, mappedB;
+    if (!fileA.empty()) {
+        try {
+            mappedA.reset(new MappedMatrix<int>(fileA));
+            mappedB.reset(new MappedMatrix<int>(fileB));
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        if (mappedA->cols() != mappedB->rows()) {
+            cerr << "Cannot multiply " << mappedA->rows() << "x" << mappedA->cols() << " by "
+                 << mappedB->rows() << "x" << mappedB->cols() << endl;
+            return 1;
+        }
+        A = mappedA->view();
+        B = mappedB->view();
+    } else {
+        A = generateMatrix(N, seed);
+        B = generateMatrix(N, seed + 1);
+    }
+    
+    // Block sizes from the tuning cache written by GemmAutotune, if any
+    gemm::BlockSizes bs;
+    gemm::TuningCache cache;
+    cache.load();
+    if (const gemm::TuningEntry* tuned = cache.lookup(A.rows(), B.cols(), A.cols(), "int", "sequential")) {
+        bs = tuned->blocks;
+        cout << "Tuned blocks: mc=" << bs.mc << " kc=" << bs.kc << " nc=" << bs.nc << endl;
+    }
+    
+    // Strassen-Winograd scratch is allocated once, outside the timed region
+    gemm::StrassenOptions strassen;
+    gemm::StrassenArena<int> arena;
+    if (use_strassen) {
+        strassen.cutoff = strassen_cutoff;
+        strassen.blocks = bs;
+        arena.reserve(gemm::strassenScratchSize(A.rows(), strassen));
+        cout << "Strassen-Winograd above " << strassen.cutoff << "x" << strassen.cutoff << endl;
+    }
     
-    vector<vector<int>> A = generateMatrix(N);
-    vector<vector<int>> B = generateMatrix(N);
+    // Resolve the SIMD kernel (CPUID + self-check) before timing starts
+    cout << "GEMM kernel: " << gemm::isaName(gemm::selectedIsa<int>()) << endl;
     
     auto start = high_resolution_clock::now();
-    vector<vector<int>> C = multiplyMatrices(A, B, N);
+    Matrix<int> C = use_strassen ? multiplyMatricesStrassen(A, B, strassen, arena) : multiplyMatrices(A, B, bs);
     auto stop = high_resolution_clock::now();
     
     auto duration = duration_cast<milliseconds>(stop - start);
     cout << "Execution time: " << duration.count() << " ms" << endl;
     
-    writeMatrixToFile(C, "output_matrix.txt");
+    writeMatrixToFile(C, "output_matrix.bin");
     
     return 0;
 }
\ No newline at end of file
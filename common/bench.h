@@ -0,0 +1,170 @@
+#ifndef SIT315_BENCH_H
+#define SIT315_BENCH_H
+
+// Timing and reporting helpers for the benchmark tools.
+//
+// measure() runs a kernel a few times to warm caches, page tables and the
+// OpenMP thread team, then times each further repetition on its own. An
+// optional setup callback runs untimed before every repetition, e.g. to
+// reload an input that the kernel consumes (sorts). Timings are summarised
+// as min / median / p99 / mean. JsonWriter emits the results for
+// regression tracking, without pulling in a JSON library.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+inline double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Stats {
+    int iterations = 0;
+    double min = 0, median = 0, p99 = 0, mean = 0;   // seconds
+};
+
+// Nearest-rank percentile of sorted samples, q in [0, 1]
+inline double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t rank = size_t(std::ceil(q * double(sorted.size())));
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+inline Stats summarize(std::vector<double> seconds) {
+    Stats s;
+    s.iterations = int(seconds.size());
+    if (seconds.empty()) return s;
+    std::sort(seconds.begin(), seconds.end());
+    s.min = seconds.front();
+    s.median = seconds.size() % 2 ? seconds[seconds.size() / 2]
+                                  : 0.5 * (seconds[seconds.size() / 2 - 1] + seconds[seconds.size() / 2]);
+    s.p99 = percentile(seconds, 0.99);
+    double total = 0;
+    for (double t : seconds) total += t;
+    s.mean = total / double(seconds.size());
+    return s;
+}
+
+template <typename Setup, typename Kernel>
+Stats measure(int warmup, int iterations, Setup setup, Kernel kernel) {
+    for (int i = 0; i < warmup; i++) {
+        setup();
+        kernel();
+    }
+    std::vector<double> seconds;
+    seconds.reserve(iterations);
+    for (int i = 0; i < iterations; i++) {
+        setup();
+        double start = now();
+        kernel();
+        seconds.push_back(now() - start);
+    }
+    return summarize(seconds);
+}
+
+template <typename Kernel>
+Stats measure(int warmup, int iterations, Kernel kernel) {
+    return measure(warmup, iterations, [] {}, kernel);
+}
+
+// Streaming JSON writer: objects and arrays nest with begin/end, and
+// key()/value() separate entries automatically. Pretty-printed with two
+// spaces per level.
+class JsonWriter {
+public:
+    explicit JsonWriter(FILE* out) : out_(out) {}
+
+    JsonWriter& beginObject() { open('{'); return *this; }
+    JsonWriter& endObject() { close('}'); return *this; }
+    JsonWriter& beginArray() { open('['); return *this; }
+    JsonWriter& endArray() { close(']'); return *this; }
+
+    JsonWriter& key(const std::string& name) {
+        separate();
+        writeString(name);
+        std::fputs(": ", out_);
+        afterKey_ = true;
+        return *this;
+    }
+
+    JsonWriter& value(const std::string& s) { separate(); writeString(s); return *this; }
+    JsonWriter& value(const char* s) { return value(std::string(s)); }
+    JsonWriter& value(bool b) { separate(); std::fputs(b ? "true" : "false", out_); return *this; }
+    JsonWriter& value(int v) { return value((long long)v); }
+    JsonWriter& value(long long v) { separate(); std::fprintf(out_, "%lld", v); return *this; }
+    JsonWriter& value(double v) {
+        separate();
+        if (std::isfinite(v)) std::fprintf(out_, "%.10g", v);
+        else std::fputs("null", out_);   // JSON has no inf / nan
+        return *this;
+    }
+
+    template <typename T>
+    JsonWriter& field(const std::string& name, T v) { return key(name).value(v); }
+
+    JsonWriter& stats(const std::string& name, const Stats& s) {
+        key(name).beginObject();
+        field("iterations", s.iterations);
+        field("min_s", s.min);
+        field("median_s", s.median);
+        field("p99_s", s.p99);
+        field("mean_s", s.mean);
+        return endObject();
+    }
+
+    void finish() { std::fputc('\n', out_); }
+
+private:
+    void open(char c) {
+        separate();
+        std::fputc(c, out_);
+        first_.push_back(true);
+    }
+
+    void close(char c) {
+        bool empty = first_.back();
+        first_.pop_back();
+        if (!empty) newline();
+        std::fputc(c, out_);
+    }
+
+    // Comma and indentation before an entry, except right after a key
+    void separate() {
+        if (afterKey_) {
+            afterKey_ = false;
+            return;
+        }
+        if (first_.empty()) return;
+        if (!first_.back()) std::fputc(',', out_);
+        first_.back() = false;
+        newline();
+    }
+
+    void newline() {
+        std::fputc('\n', out_);
+        for (size_t i = 0; i < first_.size(); i++) std::fputs("  ", out_);
+    }
+
+    void writeString(const std::string& s) {
+        std::fputc('"', out_);
+        for (char c : s) {
+            if (c == '"' || c == '\\') std::fprintf(out_, "\\%c", c);
+            else if ((unsigned char)c < 0x20) std::fprintf(out_, "\\u%04x", c);
+            else std::fputc(c, out_);
+        }
+        std::fputc('"', out_);
+    }
+
+    FILE* out_;
+    std::vector<bool> first_;
+    bool afterKey_ = false;
+};
+
+} // namespace bench
+
+#endif
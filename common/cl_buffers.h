@@ -0,0 +1,113 @@
+#ifndef SIT315_CL_BUFFERS_H
+#define SIT315_CL_BUFFERS_H
+
+// Host <-> device buffer layer for the OpenCL programs.
+//
+// Buffers are allocated with CL_MEM_ALLOC_HOST_PTR and reached from the host
+// through map / unmap. On devices that share memory with the host (CPU
+// runtimes such as PoCL, integrated GPUs) that is zero-copy: the host fills
+// and reads the buffer in place, and map / unmap only hand it back and forth.
+// On discrete GPUs the same flag gives pinned (page-locked) host memory,
+// which the DMA engine reads directly, so it serves as the staging area for
+// cl_stream_kernel(): large arrays go over in chunks on two in-order queues,
+// and while one queue runs the kernel on chunk k the other uploads chunk k+1.
+//
+// Plain C; functions return CL_SUCCESS or the failing OpenCL error code.
+
+#include <stddef.h>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+
+typedef struct {
+    cl_mem mem;
+    void *ptr;              // host view while mapped, else NULL
+    size_t bytes;
+} cl_mapped_buffer;
+
+// Does the device work on host memory directly (CPU or integrated GPU)?
+static inline int cl_device_shares_host_memory(cl_device_id device) {
+    cl_device_type type = 0;
+    cl_bool unified = CL_FALSE;
+    if (clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(type), &type, NULL) == CL_SUCCESS &&
+        (type & CL_DEVICE_TYPE_CPU))
+        return 1;
+    if (clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL) == CL_SUCCESS)
+        return unified == CL_TRUE;
+    return 0;
+}
+
+// access is CL_MEM_READ_ONLY, CL_MEM_WRITE_ONLY or CL_MEM_READ_WRITE
+static inline cl_int cl_mapped_buffer_create(cl_mapped_buffer *b, cl_context context, cl_mem_flags access,
+                                             size_t bytes) {
+    cl_int err;
+    b->ptr = NULL;
+    b->bytes = bytes;
+    b->mem = clCreateBuffer(context, access | CL_MEM_ALLOC_HOST_PTR, bytes, NULL, &err);
+    return err;
+}
+
+// Blocking map of the whole buffer. Use CL_MAP_WRITE_INVALIDATE_REGION when
+// the host overwrites everything, so nothing is read back first.
+static inline cl_int cl_mapped_buffer_map(cl_mapped_buffer *b, cl_command_queue queue, cl_map_flags flags) {
+    cl_int err;
+    b->ptr = clEnqueueMapBuffer(queue, b->mem, CL_TRUE, flags, 0, b->bytes, 0, NULL, NULL, &err);
+    if (err != CL_SUCCESS) b->ptr = NULL;
+    return err;
+}
+
+static inline cl_int cl_mapped_buffer_unmap(cl_mapped_buffer *b, cl_command_queue queue) {
+    cl_int err = clEnqueueUnmapMemObject(queue, b->mem, b->ptr, 0, NULL, NULL);
+    b->ptr = NULL;
+    return err;
+}
+
+static inline void cl_mapped_buffer_release(cl_mapped_buffer *b, cl_command_queue queue) {
+    if (b->ptr) cl_mapped_buffer_unmap(b, queue);
+    if (b->mem) clReleaseMemObject(b->mem);
+    b->mem = NULL;
+}
+
+// One array of a streamed kernel: the full-size device buffer, already set
+// as a kernel argument, and its host copy (ideally a mapped, pinned buffer)
+typedef struct {
+    cl_mem device;
+    void *host;
+    size_t elem_size;
+} cl_stream_array;
+
+// Run a 1-D kernel over n elements in chunks of `chunk`, alternating between
+// the two in-order queues: per chunk, upload the inputs' slices, launch the
+// kernel with the chunk's global offset and download the outputs' slices, all
+// non-blocking. Element i of every array must depend only on element i of the
+// inputs. Returns once both queues have finished.
+static inline cl_int cl_stream_kernel(cl_command_queue queues[2], cl_kernel kernel, size_t n, size_t chunk,
+                                      const cl_stream_array *inputs, int num_inputs,
+                                      const cl_stream_array *outputs, int num_outputs) {
+    cl_int err = CL_SUCCESS;
+    if (chunk == 0) chunk = n;
+    for (size_t start = 0, c = 0; start < n && err == CL_SUCCESS; start += chunk, c++) {
+        cl_command_queue q = queues[c & 1];
+        size_t count = n - start < chunk ? n - start : chunk;
+        for (int a = 0; a < num_inputs && err == CL_SUCCESS; a++) {
+            size_t offset = start * inputs[a].elem_size;
+            err = clEnqueueWriteBuffer(q, inputs[a].device, CL_FALSE, offset, count * inputs[a].elem_size,
+                                       (const char *)inputs[a].host + offset, 0, NULL, NULL);
+        }
+        if (err == CL_SUCCESS) err = clEnqueueNDRangeKernel(q, kernel, 1, &start, &count, NULL, 0, NULL, NULL);
+        for (int a = 0; a < num_outputs && err == CL_SUCCESS; a++) {
+            size_t offset = start * outputs[a].elem_size;
+            err = clEnqueueReadBuffer(q, outputs[a].device, CL_FALSE, offset, count * outputs[a].elem_size,
+                                      (char *)outputs[a].host + offset, 0, NULL, NULL);
+        }
+        // Start this chunk before queueing the next one on the other queue
+        if (err == CL_SUCCESS) err = clFlush(q);
+    }
+    cl_int e0 = clFinish(queues[0]), e1 = clFinish(queues[1]);
+    if (err == CL_SUCCESS) err = e0 != CL_SUCCESS ? e0 : e1;
+    return err;
+}
+
+#endif
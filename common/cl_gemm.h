@@ -0,0 +1,245 @@
+#ifndef SIT315_CL_GEMM_H
+#define SIT315_CL_GEMM_H
+
+// Reusable OpenCL integer GEMM backend.
+//
+// cl_gemm_init() picks a device (GPU first, otherwise CPU, e.g. PoCL), builds
+// the embedded tiled __local-memory kernel once and caches the compiled
+// binary on disk, so later runs skip the compiler. The context, queue, kernel
+// and device buffers live in the cl_gemm struct and are reused across calls:
+// B is uploaded once with cl_gemm_set_b() and stays device resident, and
+// cl_gemm_multiply() only moves the caller's slice of A rows and C rows.
+//
+// Plain C; functions return CL_SUCCESS or the failing OpenCL error code.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#include <CL/cl.h>
+
+static const char *cl_gemm_source =
+"__kernel void gemm_tiled(__global const int* A, __global const int* B, __global int* C,\n"
+"                         int M, int N, int K) {\n"
+"    __local int As[TILE][TILE];\n"
+"    __local int Bs[TILE][TILE];\n"
+"    int col = get_global_id(0), row = get_global_id(1);\n"
+"    int lc = get_local_id(0), lr = get_local_id(1);\n"
+"    int acc = 0;\n"
+"    for (int t = 0; t < K; t += TILE) {\n"
+"        As[lr][lc] = (row < M && t + lc < K) ? A[row * K + t + lc] : 0;\n"
+"        Bs[lr][lc] = (t + lr < K && col < N) ? B[(t + lr) * N + col] : 0;\n"
+"        barrier(CLK_LOCAL_MEM_FENCE);\n"
+"        for (int k = 0; k < TILE; k++)\n"
+"            acc += As[lr][k] * Bs[k][lc];\n"
+"        barrier(CLK_LOCAL_MEM_FENCE);\n"
+"    }\n"
+"    if (row < M && col < N)\n"
+"        C[row * N + col] = acc;\n"
+"}\n";
+
+typedef struct {
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel kernel;
+    int tile;
+    cl_mem a, b, c;
+    size_t a_bytes, b_bytes, c_bytes;
+    int k, n;   // shape of the resident B
+} cl_gemm;
+
+static inline void cl_gemm_error(const char *what, cl_int err) {
+    fprintf(stderr, "cl_gemm: %s failed (%d)\n", what, err);
+}
+
+// Prefer a GPU on any platform, then a CPU device (PoCL and friends)
+static inline cl_int cl_gemm_pick_device(cl_device_id *device) {
+    cl_platform_id platforms[8];
+    cl_uint num_platforms = 0;
+    cl_int err = clGetPlatformIDs(8, platforms, &num_platforms);
+    if (err != CL_SUCCESS) return err;
+    if (num_platforms > 8) num_platforms = 8;
+    cl_device_type types[2] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_CPU};
+    for (int t = 0; t < 2; t++)
+        for (cl_uint p = 0; p < num_platforms; p++)
+            if (clGetDeviceIDs(platforms[p], types[t], 1, device, NULL) == CL_SUCCESS)
+                return CL_SUCCESS;
+    return CL_DEVICE_NOT_FOUND;
+}
+
+// Cache file name derived from device, driver, tile size and kernel source,
+// so a driver upgrade or kernel edit never loads a stale binary
+static inline void cl_gemm_cache_path(const cl_gemm *g, const char *cache_dir, char *path, size_t len) {
+    char name[256] = "", driver[256] = "";
+    clGetDeviceInfo(g->device, CL_DEVICE_NAME, sizeof(name) - 1, name, NULL);
+    clGetDeviceInfo(g->device, CL_DRIVER_VERSION, sizeof(driver) - 1, driver, NULL);
+    unsigned long h = 5381;
+    const char *parts[3] = {name, driver, cl_gemm_source};
+    for (int i = 0; i < 3; i++)
+        for (const char *s = parts[i]; *s; s++)
+            h = h * 33 + (unsigned char)*s;
+    h = h * 33 + (unsigned long)g->tile;
+    snprintf(path, len, "%s/cl_gemm_%08lx.bin", cache_dir ? cache_dir : ".", h & 0xffffffffUL);
+}
+
+static inline cl_int cl_gemm_build(cl_gemm *g, const char *cache_dir) {
+    char options[64], path[512];
+    cl_int err;
+    snprintf(options, sizeof(options), "-DTILE=%d", g->tile);
+    cl_gemm_cache_path(g, cache_dir, path, sizeof(path));
+
+    // Try the cached binary first
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        fseek(f, 0, SEEK_END);
+        size_t size = (size_t)ftell(f);
+        fseek(f, 0, SEEK_SET);
+        unsigned char *binary = (unsigned char *)malloc(size);
+        size_t got = fread(binary, 1, size, f);
+        fclose(f);
+        if (got == size) {
+            cl_int status;
+            const unsigned char *bin = binary;
+            g->program = clCreateProgramWithBinary(g->context, 1, &g->device, &size, &bin, &status, &err);
+            if (err == CL_SUCCESS && status == CL_SUCCESS &&
+                clBuildProgram(g->program, 1, &g->device, options, NULL, NULL) == CL_SUCCESS) {
+                free(binary);
+                return CL_SUCCESS;
+            }
+            if (g->program) clReleaseProgram(g->program);
+            g->program = NULL;
+        }
+        free(binary);
+    }
+
+    // Build from the embedded source and store the binary for next time
+    g->program = clCreateProgramWithSource(g->context, 1, &cl_gemm_source, NULL, &err);
+    if (err != CL_SUCCESS) return err;
+    err = clBuildProgram(g->program, 1, &g->device, options, NULL, NULL);
+    if (err != CL_SUCCESS) {
+        size_t log_size = 0;
+        clGetProgramBuildInfo(g->program, g->device, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
+        char *log = (char *)malloc(log_size + 1);
+        clGetProgramBuildInfo(g->program, g->device, CL_PROGRAM_BUILD_LOG, log_size, log, NULL);
+        log[log_size] = '\0';
+        fprintf(stderr, "cl_gemm build log:\n%s\n", log);
+        free(log);
+        return err;
+    }
+    size_t size = 0;
+    if (clGetProgramInfo(g->program, CL_PROGRAM_BINARY_SIZES, sizeof(size), &size, NULL) == CL_SUCCESS && size > 0) {
+        unsigned char *binary = (unsigned char *)malloc(size);
+        if (clGetProgramInfo(g->program, CL_PROGRAM_BINARIES, sizeof(binary), &binary, NULL) == CL_SUCCESS) {
+            // Write then rename, so concurrent ranks never read a partial file
+            char tmp[544];
+            snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+            f = fopen(tmp, "wb");
+            if (f) {
+                size_t written = fwrite(binary, 1, size, f);
+                fclose(f);
+                if (written != size || rename(tmp, path) != 0) remove(tmp);
+            }
+        }
+        free(binary);
+    }
+    return CL_SUCCESS;
+}
+
+// One-time setup. cache_dir may be NULL for the current directory.
+static inline cl_int cl_gemm_init(cl_gemm *g, const char *cache_dir) {
+    cl_int err;
+    memset(g, 0, sizeof(*g));
+    if ((err = cl_gemm_pick_device(&g->device)) != CL_SUCCESS) {
+        cl_gemm_error("device selection", err);
+        return err;
+    }
+    g->context = clCreateContext(NULL, 1, &g->device, NULL, NULL, &err);
+    if (err != CL_SUCCESS) { cl_gemm_error("clCreateContext", err); return err; }
+    g->queue = clCreateCommandQueue(g->context, g->device, 0, &err);
+    if (err != CL_SUCCESS) { cl_gemm_error("clCreateCommandQueue", err); return err; }
+
+    // 16x16 work-groups unless the device cannot run that many work-items
+    size_t max_group = 0;
+    clGetDeviceInfo(g->device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_group), &max_group, NULL);
+    g->tile = max_group >= 256 ? 16 : (max_group >= 64 ? 8 : 4);
+
+    if ((err = cl_gemm_build(g, cache_dir)) != CL_SUCCESS) { cl_gemm_error("program build", err); return err; }
+    g->kernel = clCreateKernel(g->program, "gemm_tiled", &err);
+    if (err != CL_SUCCESS) { cl_gemm_error("clCreateKernel", err); return err; }
+    return CL_SUCCESS;
+}
+
+// Grow a device buffer only when a larger size is needed
+static inline cl_int cl_gemm_reserve(cl_gemm *g, cl_mem *buf, size_t *cap, size_t bytes, cl_mem_flags flags) {
+    cl_int err = CL_SUCCESS;
+    if (bytes == 0) bytes = 1;
+    if (*buf && *cap >= bytes) return CL_SUCCESS;
+    if (*buf) clReleaseMemObject(*buf);
+    *buf = clCreateBuffer(g->context, flags, bytes, NULL, &err);
+    *cap = err == CL_SUCCESS ? bytes : 0;
+    return err;
+}
+
+// Upload B (k x n, row-major); it stays on the device for later multiplies
+static inline cl_int cl_gemm_set_b(cl_gemm *g, const int *B, int k, int n) {
+    size_t bytes = (size_t)k * n * sizeof(int);
+    cl_int err = cl_gemm_reserve(g, &g->b, &g->b_bytes, bytes, CL_MEM_READ_ONLY);
+    if (err != CL_SUCCESS) { cl_gemm_error("B buffer", err); return err; }
+    if (bytes > 0) err = clEnqueueWriteBuffer(g->queue, g->b, CL_TRUE, 0, bytes, B, 0, NULL, NULL);
+    if (err != CL_SUCCESS) { cl_gemm_error("B upload", err); return err; }
+    g->k = k;
+    g->n = n;
+    return CL_SUCCESS;
+}
+
+// C_rows (m x n) = A_rows (m x k) * resident B. Only the m rows are transferred.
+static inline cl_int cl_gemm_multiply(cl_gemm *g, const int *A_rows, int m, int *C_rows) {
+    int k = g->k, n = g->n;
+    size_t a_bytes = (size_t)m * k * sizeof(int), c_bytes = (size_t)m * n * sizeof(int);
+    cl_int err;
+    if (m == 0 || n == 0) return CL_SUCCESS;
+    if ((err = cl_gemm_reserve(g, &g->a, &g->a_bytes, a_bytes, CL_MEM_READ_ONLY)) != CL_SUCCESS ||
+        (err = cl_gemm_reserve(g, &g->c, &g->c_bytes, c_bytes, CL_MEM_WRITE_ONLY)) != CL_SUCCESS) {
+        cl_gemm_error("A/C buffers", err);
+        return err;
+    }
+    if (a_bytes > 0 &&
+        (err = clEnqueueWriteBuffer(g->queue, g->a, CL_FALSE, 0, a_bytes, A_rows, 0, NULL, NULL)) != CL_SUCCESS) {
+        cl_gemm_error("A upload", err);
+        return err;
+    }
+    clSetKernelArg(g->kernel, 0, sizeof(cl_mem), &g->a);
+    clSetKernelArg(g->kernel, 1, sizeof(cl_mem), &g->b);
+    clSetKernelArg(g->kernel, 2, sizeof(cl_mem), &g->c);
+    clSetKernelArg(g->kernel, 3, sizeof(int), &m);
+    clSetKernelArg(g->kernel, 4, sizeof(int), &n);
+    clSetKernelArg(g->kernel, 5, sizeof(int), &k);
+
+    size_t tile = (size_t)g->tile;
+    size_t local[2] = {tile, tile};
+    size_t global[2] = {(n + tile - 1) / tile * tile, (m + tile - 1) / tile * tile};
+    err = clEnqueueNDRangeKernel(g->queue, g->kernel, 2, NULL, global, local, 0, NULL, NULL);
+    if (err != CL_SUCCESS) { cl_gemm_error("clEnqueueNDRangeKernel", err); return err; }
+    err = clEnqueueReadBuffer(g->queue, g->c, CL_TRUE, 0, c_bytes, C_rows, 0, NULL, NULL);
+    if (err != CL_SUCCESS) cl_gemm_error("C readback", err);
+    return err;
+}
+
+static inline void cl_gemm_release(cl_gemm *g) {
+    if (g->a) clReleaseMemObject(g->a);
+    if (g->b) clReleaseMemObject(g->b);
+    if (g->c) clReleaseMemObject(g->c);
+    if (g->kernel) clReleaseKernel(g->kernel);
+    if (g->program) clReleaseProgram(g->program);
+    if (g->queue) clReleaseCommandQueue(g->queue);
+    if (g->context) clReleaseContext(g->context);
+    memset(g, 0, sizeof(*g));
+}
+
+#endif
@@ -0,0 +1,571 @@
+#ifndef SIT315_EXTERNAL_SORT_H
+#define SIT315_EXTERNAL_SORT_H
+
+// Out-of-core sort for key files larger than memory. Files hold raw int32
+// keys in native byte order with no header.
+//
+// Run formation reads memory-sized runs with large sequential reads, sorts
+// each run in parallel (radix sort or quicksort, whichever
+// chooseSortAlgorithm picks) while a second thread reads the next one, and
+// writes every sorted run to a temporary file in one large write. The
+// merge combines the runs with the loser tree of kway_merge.h. A read-ahead
+// thread keeps two buffers per run, so the next block of a run is normally
+// loaded before the merge reaches it, and a write-behind thread drains the
+// output from another pair of buffers. If there are more runs than the
+// memory budget has buffers for, intermediate passes merge them in groups
+// first. Input that fits in one run is sorted in memory and written
+// directly.
+//
+// Every phase reports its time and the bytes it read and wrote. I/O errors
+// throw std::runtime_error; temporary run files are removed either way.
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "kway_merge.h"
+#include "quicksort.h"
+#include "radix_sort.h"
+
+namespace sorting {
+
+// Merge buffers are kept between these sizes; the fan-in of one merge pass
+// is limited so that every run still gets two EXTERNAL_MIN_BLOCK buffers
+const size_t EXTERNAL_MIN_BLOCK = size_t(1) << 20;
+const size_t EXTERNAL_MAX_BLOCK = size_t(16) << 20;
+
+struct ExternalSortOptions {
+    size_t memoryBytes = size_t(1) << 30;  // budget for run and merge buffers
+    std::string tempDir = ".";             // where the sorted runs go
+    int numThreads = 0;                    // sorting threads, 0 = OpenMP default
+};
+
+struct ExternalSortPhase {
+    std::string name;
+    double seconds = 0;
+    double waitSeconds = 0;                // time the phase stalled on reads
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+};
+
+struct ExternalSortStats {
+    uint64_t keys = 0;
+    size_t runs = 0;
+    double sortSeconds = 0;                // in-memory sorting within run formation
+    std::vector<ExternalSortPhase> phases;
+};
+
+namespace detail {
+
+inline double secondsNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+[[noreturn]] inline void ioError(const std::string& what, const std::string& path, int err) {
+    throw std::runtime_error(what + " " + path + ": " + std::strerror(err));
+}
+
+// Read exactly bytes at offset; returns 0 or the errno of the failure
+inline int preadFully(int fd, void* buf, size_t bytes, uint64_t offset) {
+    char* p = static_cast<char*>(buf);
+    while (bytes > 0) {
+        ssize_t got = ::pread(fd, p, bytes, off_t(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) return errno;
+        if (got == 0) return EIO;  // file shrank underneath us
+        p += got;
+        bytes -= size_t(got);
+        offset += uint64_t(got);
+    }
+    return 0;
+}
+
+inline int writeFully(int fd, const void* buf, size_t bytes) {
+    const char* p = static_cast<const char*>(buf);
+    while (bytes > 0) {
+        ssize_t put = ::write(fd, p, bytes);
+        if (put < 0 && errno == EINTR) continue;
+        if (put < 0) return errno;
+        p += put;
+        bytes -= size_t(put);
+    }
+    return 0;
+}
+
+// Create path holding exactly bytes from buf; returns 0 or the errno of the
+// failure
+inline int writeFile(const std::string& path, const void* buf, size_t bytes) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return errno;
+    int err = writeFully(fd, buf, bytes);
+    if (::close(fd) != 0 && err == 0) err = errno;
+    return err;
+}
+
+// File descriptor closed when it goes out of scope
+class FileHandle {
+public:
+    FileHandle(const std::string& path, int flags) : path_(path) {
+        fd_ = ::open(path.c_str(), flags, 0644);
+        if (fd_ < 0) ioError("cannot open", path, errno);
+    }
+    ~FileHandle() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    int fd() const { return fd_; }
+    const std::string& path() const { return path_; }
+
+    // Close now, reporting errors that only show up at close (e.g. NFS)
+    void close() {
+        int fd = fd_;
+        fd_ = -1;
+        if (::close(fd) != 0) ioError("cannot close", path_, errno);
+    }
+
+private:
+    int fd_;
+    std::string path_;
+};
+
+struct RunFile {
+    std::string path;
+    uint64_t keys;
+};
+
+// Temporary run files, unlinked when merged or when the sort is abandoned
+class RunSet {
+public:
+    explicit RunSet(const std::string& dir) : dir_(dir) {}
+    ~RunSet() {
+        for (const RunFile& run : runs) ::unlink(run.path.c_str());
+    }
+    RunSet(const RunSet&) = delete;
+    RunSet& operator=(const RunSet&) = delete;
+
+    std::string newPath() {
+        return dir_ + "/extsort-" + std::to_string(::getpid()) + "-" + std::to_string(counter_++) + ".run";
+    }
+
+    // Unlink runs [first, last) and drop them from the set
+    void remove(size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) ::unlink(runs[i].path.c_str());
+        runs.erase(runs.begin() + first, runs.begin() + last);
+    }
+
+    std::vector<RunFile> runs;
+
+private:
+    std::string dir_;
+    unsigned counter_ = 0;
+};
+
+inline void sortRun(int* first, int* last, int numThreads) {
+    if (chooseSortAlgorithm(first, last, numThreads) == SortAlgorithm::Radix) radixSort(first, last, numThreads);
+    else parallelQuicksort(first, last, numThreads);
+}
+
+// Runs one merge may have open at once under the descriptor limit, less
+// stdin/stdout/stderr, the input, the output and a few spare
+inline size_t descriptorFanIn() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) return SIZE_MAX;
+    return limit.rlim_cur > 10 ? size_t(limit.rlim_cur) - 8 : 2;
+}
+
+// Most runs one merge pass can take within the memory budget and the
+// descriptor limit; at least 2, so small budgets still make progress
+inline size_t maxFanIn(size_t memoryBytes) {
+    size_t byMemory = memoryBytes / (2 * EXTERNAL_MIN_BLOCK);
+    return std::max<size_t>(2, std::min(byMemory, descriptorFanIn()));
+}
+
+// Bytes per merge buffer for k inputs: two buffers per input and two for
+// the output share the budget, in whole pages
+inline size_t mergeBlockBytes(size_t memoryBytes, size_t k) {
+    size_t block = std::min(memoryBytes / (2 * (k + 1)), EXTERNAL_MAX_BLOCK);
+    return std::max<size_t>(block & ~size_t(4095), 4096);
+}
+
+// Background reader for the inputs of one merge. Each run has two buffers:
+// one the merge is reading from and one being filled with the next block.
+class ReadAhead {
+public:
+    ReadAhead(const std::vector<RunFile>& runs, size_t blockKeys) : blockKeys_(blockKeys), runs_(runs.size()) {
+        for (size_t r = 0; r < runs.size(); r++) {
+            Run& run = runs_[r];
+            run.file.reset(new FileHandle(runs[r].path, O_RDONLY));
+            posix_fadvise(run.file->fd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+            run.remaining = runs[r].keys;
+            run.buffer[0].resize(blockKeys);
+            run.buffer[1].resize(blockKeys);
+            request(run, 0);
+            request(run, 1);
+        }
+        thread_ = std::thread([this] { readLoop(); });
+    }
+
+    ~ReadAhead() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    ReadAhead(const ReadAhead&) = delete;
+    ReadAhead& operator=(const ReadAhead&) = delete;
+
+    // Next block of run r, handing the previous one back for refilling.
+    // Returns its length in keys, 0 at the end of the run or after an error.
+    size_t next(int r, const int** data) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Run& run = runs_[r];
+        if (run.held >= 0) {
+            request(run, run.held);
+            run.held = -1;
+            wake_.notify_one();
+        }
+        const int b = run.next;
+        if (run.state[b] == Queued) {
+            double start = secondsNow();
+            ready_.wait(lock, [&] { return run.state[b] != Queued || error_ != 0; });
+            waitSeconds_ += secondsNow() - start;
+        }
+        if (error_ != 0 || run.state[b] != Ready) return 0;
+        run.state[b] = Held;
+        run.held = b;
+        run.next = 1 - b;
+        *data = run.buffer[b].data();
+        return run.length[b];
+    }
+
+    static size_t refill(void* ctx, int run, const int** data) {
+        return static_cast<ReadAhead*>(ctx)->next(run, data);
+    }
+
+    // Throws if any read failed
+    void check() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_ != 0) ioError("cannot read", errorPath_, error_);
+    }
+
+    uint64_t bytesRead() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytesRead_;
+    }
+
+    double waitSeconds() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return waitSeconds_;
+    }
+
+private:
+    enum State { Empty, Queued, Ready, Held };
+
+    struct Run {
+        std::unique_ptr<FileHandle> file;
+        uint64_t offset = 0;          // next byte to request
+        uint64_t remaining = 0;       // keys not yet requested
+        std::vector<int> buffer[2];
+        size_t length[2] = {0, 0};
+        State state[2] = {Empty, Empty};
+        int next = 0;                 // buffer the merge takes next
+        int held = -1;                // buffer the merge is reading
+    };
+
+    // Queue buffer b for the run's next block (caller holds the lock).
+    // Blocks are requested in file order alternating between the buffers,
+    // which is also the order next() hands them out.
+    void request(Run& run, int b) {
+        if (run.remaining == 0) {
+            run.state[b] = Empty;
+            return;
+        }
+        size_t keys = size_t(std::min<uint64_t>(blockKeys_, run.remaining));
+        run.length[b] = keys;
+        run.state[b] = Queued;
+        queue_.push_back(Request{&run, b, run.offset, keys});
+        run.offset += uint64_t(keys) * sizeof(int);
+        run.remaining -= keys;
+    }
+
+    struct Request {
+        Run* run;
+        int buffer;
+        uint64_t offset;
+        size_t keys;
+    };
+
+    void readLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            Request req = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+            int err = preadFully(req.run->file->fd(), req.run->buffer[req.buffer].data(), req.keys * sizeof(int),
+                                 req.offset);
+            lock.lock();
+            if (err != 0 && error_ == 0) {
+                error_ = err;
+                errorPath_ = req.run->file->path();
+            }
+            req.run->state[req.buffer] = Ready;
+            bytesRead_ += req.keys * sizeof(int);
+            ready_.notify_all();
+        }
+    }
+
+    const size_t blockKeys_;
+    std::vector<Run> runs_;
+    std::deque<Request> queue_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_, ready_;
+    bool stop_ = false;
+    int error_ = 0;
+    std::string errorPath_;
+    uint64_t bytesRead_ = 0;
+    double waitSeconds_ = 0;
+    std::thread thread_;
+};
+
+// Background writer with two buffers: the caller fills one while the other
+// is written out
+class WriteBehind {
+public:
+    WriteBehind(FileHandle& file, size_t blockKeys) : file_(file) {
+        buffer_[0].resize(blockKeys);
+        buffer_[1].resize(blockKeys);
+        thread_ = std::thread([this] { writeLoop(); });
+    }
+
+    ~WriteBehind() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    WriteBehind(const WriteBehind&) = delete;
+    WriteBehind& operator=(const WriteBehind&) = delete;
+
+    size_t capacity() const { return buffer_[0].size(); }
+
+    // The buffer to fill next, once its previous contents are written
+    int* buffer() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return pending_[current_] == 0; });
+        return buffer_[current_].data();
+    }
+
+    // Queue the first keys of buffer() for writing and switch buffers
+    void submit(size_t keys) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_[current_] = keys;
+            order_.push_back(current_);
+            current_ = 1 - current_;
+        }
+        wake_.notify_one();
+    }
+
+    // Wait for every queued write; throws if any failed
+    void finish() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return order_.empty(); });
+        if (error_ != 0) ioError("cannot write", file_.path(), error_);
+    }
+
+    uint64_t bytesWritten() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytesWritten_;
+    }
+
+private:
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&] { return stop_ || !order_.empty(); });
+            if (order_.empty()) return;
+            int b = order_.front();
+            size_t keys = pending_[b];
+            lock.unlock();
+            int err = error_ == 0 ? writeFully(file_.fd(), buffer_[b].data(), keys * sizeof(int)) : 0;
+            lock.lock();
+            if (err != 0 && error_ == 0) error_ = err;
+            bytesWritten_ += keys * sizeof(int);
+            pending_[b] = 0;
+            order_.pop_front();
+            done_.notify_all();
+        }
+    }
+
+    FileHandle& file_;
+    std::vector<int> buffer_[2];
+    size_t pending_[2] = {0, 0};
+    int current_ = 0;
+    std::deque<int> order_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    bool stop_ = false;
+    int error_ = 0;
+    uint64_t bytesWritten_ = 0;
+    std::thread thread_;
+};
+
+// Merge the given runs into a new file at outPath
+inline void mergeRunFiles(const std::vector<RunFile>& runs, const std::string& outPath, size_t memoryBytes,
+                          ExternalSortPhase& phase) {
+    const size_t blockKeys = mergeBlockBytes(memoryBytes, runs.size()) / sizeof(int);
+    FileHandle out(outPath, O_WRONLY | O_CREAT | O_TRUNC);
+    try {
+        ReadAhead in(runs, blockKeys);
+        WriteBehind writer(out, blockKeys);
+        std::vector<const int*> first(runs.size(), nullptr);
+        std::vector<size_t> lengths(runs.size(), 0);
+        kway_merge m;
+        if (kway_merge_init(&m, int(runs.size()), first.data(), lengths.data(), ReadAhead::refill, &in) != 0)
+            throw std::bad_alloc();
+        size_t keys;
+        while ((keys = kway_merge_next(&m, writer.buffer(), writer.capacity())) > 0) writer.submit(keys);
+        kway_merge_free(&m);
+        writer.finish();
+        in.check();
+        phase.bytesRead += in.bytesRead();
+        phase.bytesWritten += writer.bytesWritten();
+        phase.waitSeconds += in.waitSeconds();
+    } catch (...) {
+        // Do not leave a truncated output behind
+        ::unlink(outPath.c_str());
+        throw;
+    }
+    out.close();
+}
+
+} // namespace detail
+
+// Sort the int32 keys of input into output using about options.memoryBytes
+// of memory (plus the sort's own per-thread buffers)
+inline ExternalSortStats externalSort(const std::string& input, const std::string& output,
+                                      const ExternalSortOptions& options = ExternalSortOptions()) {
+    using namespace detail;
+    ExternalSortStats stats;
+    FileHandle in(input, O_RDONLY);
+    struct stat st;
+    if (fstat(in.fd(), &st) != 0) ioError("cannot stat", input, errno);
+    if (st.st_size % sizeof(int) != 0) throw std::runtime_error(input + " is not a whole number of int32 keys");
+    posix_fadvise(in.fd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    stats.keys = uint64_t(st.st_size) / sizeof(int);
+
+    // One buffer being sorted, one being read, and scratch for the radix sort
+    const uint64_t runKeys = std::max<uint64_t>(1024, options.memoryBytes / (3 * sizeof(int)));
+    const size_t bufferKeys = size_t(std::min(runKeys, std::max<uint64_t>(stats.keys, 1)));
+    RunSet runs(options.tempDir);
+
+    ExternalSortPhase formation;
+    formation.name = stats.keys <= runKeys ? "in-memory sort" : "run formation";
+    double phaseStart = secondsNow();
+    {
+        std::vector<int> current(bufferKeys), next(bufferKeys);
+        size_t currentKeys = size_t(std::min(runKeys, stats.keys));
+        int err = preadFully(in.fd(), current.data(), currentKeys * sizeof(int), 0);
+        if (err != 0) ioError("cannot read", input, err);
+        uint64_t readKeys = currentKeys;
+        formation.bytesRead += currentKeys * sizeof(int);
+        if (currentKeys == 0 && (err = writeFile(output, nullptr, 0)) != 0) ioError("cannot write", output, err);
+
+        while (currentKeys > 0) {
+            // Read the next run while this one is sorted and written
+            size_t nextKeys = size_t(std::min(runKeys, stats.keys - readKeys));
+            int readErr = 0;
+            std::thread reader;
+            if (nextKeys > 0)
+                reader = std::thread([&, readKeys] {
+                    readErr = preadFully(in.fd(), next.data(), nextKeys * sizeof(int), readKeys * sizeof(int));
+                });
+
+            double sortStart = secondsNow();
+            sortRun(current.data(), current.data() + currentKeys, options.numThreads);
+            stats.sortSeconds += secondsNow() - sortStart;
+
+            // Everything fits in one run: write the result directly
+            const bool single = runs.runs.empty() && nextKeys == 0;
+            const std::string path = single ? output : runs.newPath();
+            if (!single) runs.runs.push_back(RunFile{path, currentKeys});
+            int writeErr = writeFile(path, current.data(), currentKeys * sizeof(int));
+            if (reader.joinable()) {
+                double waitStart = secondsNow();
+                reader.join();
+                formation.waitSeconds += secondsNow() - waitStart;
+            }
+            if (writeErr != 0) ioError("cannot write", path, writeErr);
+            if (readErr != 0) ioError("cannot read", input, readErr);
+            formation.bytesWritten += currentKeys * sizeof(int);
+            formation.bytesRead += nextKeys * sizeof(int);
+            readKeys += nextKeys;
+            currentKeys = nextKeys;
+            std::swap(current, next);
+        }
+    }
+    formation.seconds = secondsNow() - phaseStart;
+    stats.phases.push_back(formation);
+    stats.runs = runs.runs.size();
+    if (runs.runs.empty()) return stats;
+
+    // Intermediate passes until one merge can take every remaining run
+    const size_t fanIn = maxFanIn(options.memoryBytes);
+    for (int pass = 1; runs.runs.size() > fanIn; pass++) {
+        ExternalSortPhase phase;
+        phase.name = "merge pass " + std::to_string(pass);
+        phaseStart = secondsNow();
+        const size_t count = runs.runs.size();
+        for (size_t first = 0; first < count; first += fanIn) {
+            // The inputs of this group are always at the front
+            const size_t group = std::min(fanIn, count - first);
+            std::vector<RunFile> inputs(runs.runs.begin(), runs.runs.begin() + group);
+            RunFile merged{runs.newPath(), 0};
+            for (const RunFile& run : inputs) merged.keys += run.keys;
+            runs.runs.push_back(merged);
+            mergeRunFiles(inputs, merged.path, options.memoryBytes, phase);
+            runs.remove(0, group);
+        }
+        phase.seconds = secondsNow() - phaseStart;
+        stats.phases.push_back(phase);
+    }
+
+    ExternalSortPhase last;
+    last.name = "final merge";
+    phaseStart = secondsNow();
+    mergeRunFiles(runs.runs, output, options.memoryBytes, last);
+    last.seconds = secondsNow() - phaseStart;
+    stats.phases.push_back(last);
+    runs.remove(0, runs.runs.size());
+    return stats;
+}
+
+} // namespace sorting
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef SIT315_GEMM_KERNELS_H
+#define SIT315_GEMM_KERNELS_H
+
+// Register-blocked GEMM micro-kernels for int and float, one per instruction
+// set, selected at startup from CPUID so a single binary runs on every node
+// generation. Included by matrix.h; not meant to be used on its own.
+//
+// Every kernel accumulates each C element over k in the same order and float
+// kernels use separate multiply and add (never FMA), so all variants produce
+// bit-identical results. The selected kernel is checked against the scalar one
+// on first use and demoted to the next narrower ISA if they ever disagree.
+//
+// Set GEMM_ISA=scalar|sse4|avx2|avx512 to force a particular kernel.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEMM_X86 1
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define GEMM_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define GEMM_NO_CONTRACT
+#endif
+
+namespace gemm {
+
+const int MR = 4;
+const int NR = 16;
+
+enum class Isa { Scalar = 0, SSE4 = 1, AVX2 = 2, AVX512 = 3 };
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::SSE4: return "sse4";
+    case Isa::AVX2: return "avx2";
+    case Isa::AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+// C[0:mr, 0:nr] += packedA (MR x kc, k-major) * packedB (kc x NR, k-major)
+template <typename T>
+using MicroKernel = void (*)(int kc, const T* a, const T* b, T* C, size_t ldc, int mr, int nr);
+
+namespace detail {
+
+template <typename T>
+inline void addBlock(const T* acc, T* C, size_t ldc, int mr, int nr) {
+    for (int i = 0; i < mr; i++)
+        for (int j = 0; j < nr; j++) C[size_t(i) * ldc + j] += acc[i * NR + j];
+}
+
+template <typename T>
+GEMM_NO_CONTRACT void kernelScalar(int kc, const T* a, const T* b, T* C, size_t ldc, int mr, int nr) {
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+    T acc[MR * NR] = {};
+    for (int k = 0; k < kc; k++) {
+        for (int i = 0; i < MR; i++) {
+            T av = a[i];
+            for (int j = 0; j < NR; j++) acc[i * NR + j] += av * b[j];
+        }
+        a += MR;
+        b += NR;
+    }
+    addBlock(acc, C, ldc, mr, nr);
+}
+
+#ifdef GEMM_X86
+
+// ---- SSE4.1: four 128-bit vectors per row of the register block ----
+
+__attribute__((target("sse4.1")))
+inline void kernelIntSSE4(int kc, const int* a, const int* b, int* C, size_t ldc, int mr, int nr) {
+    __m128i acc[MR][4];
+    for (int i = 0; i < MR; i++)
+        for (int v = 0; v < 4; v++) acc[i][v] = _mm_setzero_si128();
+    for (int k = 0; k < kc; k++) {
+        __m128i b0 = _mm_load_si128((const __m128i*)(b + 0));
+        __m128i b1 = _mm_load_si128((const __m128i*)(b + 4));
+        __m128i b2 = _mm_load_si128((const __m128i*)(b + 8));
+        __m128i b3 = _mm_load_si128((const __m128i*)(b + 12));
+        for (int i = 0; i < MR; i++) {
+            __m128i av = _mm_set1_epi32(a[i]);
+            acc[i][0] = _mm_add_epi32(acc[i][0], _mm_mullo_epi32(av, b0));
+            acc[i][1] = _mm_add_epi32(acc[i][1], _mm_mullo_epi32(av, b1));
+            acc[i][2] = _mm_add_epi32(acc[i][2], _mm_mullo_epi32(av, b2));
+            acc[i][3] = _mm_add_epi32(acc[i][3], _mm_mullo_epi32(av, b3));
+        }
+        a += MR;
+        b += NR;
+    }
+    alignas(64) int out[MR * NR];
+    for (int i = 0; i < MR; i++)
+        for (int v = 0; v < 4; v++) _mm_store_si128((__m128i*)(out + i * NR + v * 4), acc[i][v]);
+    addBlock(out, C, ldc, mr, nr);
+}
+
+__attribute__((target("sse4.1"))) GEMM_NO_CONTRACT
+inline void kernelFloatSSE4(int kc, const float* a, const float* b, float* C, size_t ldc, int mr, int nr) {
+    __m128 acc[MR][4];
+    for (int i = 0; i < MR; i++)
+        for (int v = 0; v < 4; v++) acc[i][v] = _mm_setzero_ps();
+    for (int k = 0; k < kc; k++) {
+        __m128 b0 = _mm_load_ps(b + 0);
+        __m128 b1 = _mm_load_ps(b + 4);
+        __m128 b2 = _mm_load_ps(b + 8);
+        __m128 b3 = _mm_load_ps(b + 12);
+        for (int i = 0; i < MR; i++) {
+            __m128 av = _mm_set1_ps(a[i]);
+            acc[i][0] = _mm_add_ps(acc[i][0], _mm_mul_ps(av, b0));
+            acc[i][1] = _mm_add_ps(acc[i][1], _mm_mul_ps(av, b1));
+            acc[i][2] = _mm_add_ps(acc[i][2], _mm_mul_ps(av, b2));
+            acc[i][3] = _mm_add_ps(acc[i][3], _mm_mul_ps(av, b3));
+        }
+        a += MR;
+        b += NR;
+    }
+    alignas(64) float out[MR * NR];
+    for (int i = 0; i < MR; i++)
+        for (int v = 0; v < 4; v++) _mm_store_ps(out + i * NR + v * 4, acc[i][v]);
+    addBlock(out, C, ldc, mr, nr);
+}
+
+// ---- AVX2: two 256-bit vectors per row ----
+
+__attribute__((target("avx2")))
+inline void kernelIntAVX2(int kc, const int* a, const int* b, int* C, size_t ldc, int mr, int nr) {
+    __m256i acc[MR][2];
+    for (int i = 0; i < MR; i++) acc[i][0] = acc[i][1] = _mm256_setzero_si256();
+    for (int k = 0; k < kc; k++) {
+        __m256i b0 = _mm256_load_si256((const __m256i*)(b + 0));
+        __m256i b1 = _mm256_load_si256((const __m256i*)(b + 8));
+        for (int i = 0; i < MR; i++) {
+            __m256i av = _mm256_set1_epi32(a[i]);
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_mullo_epi32(av, b0));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_mullo_epi32(av, b1));
+        }
+        a += MR;
+        b += NR;
+    }
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; i++) {
+            __m256i* c = (__m256i*)(C + size_t(i) * ldc);
+            _mm256_storeu_si256(c, _mm256_add_epi32(_mm256_loadu_si256(c), acc[i][0]));
+            _mm256_storeu_si256(c + 1, _mm256_add_epi32(_mm256_loadu_si256(c + 1), acc[i][1]));
+        }
+        return;
+    }
+    alignas(64) int out[MR * NR];
+    for (int i = 0; i < MR; i++) {
+        _mm256_store_si256((__m256i*)(out + i * NR), acc[i][0]);
+        _mm256_store_si256((__m256i*)(out + i * NR + 8), acc[i][1]);
+    }
+    addBlock(out, C, ldc, mr, nr);
+}
+
+__attribute__((target("avx2"))) GEMM_NO_CONTRACT
+inline void kernelFloatAVX2(int kc, const float* a, const float* b, float* C, size_t ldc, int mr, int nr) {
+    __m256 acc[MR][2];
+    for (int i = 0; i < MR; i++) acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+    for (int k = 0; k < kc; k++) {
+        __m256 b0 = _mm256_load_ps(b + 0);
+        __m256 b1 = _mm256_load_ps(b + 8);
+        for (int i = 0; i < MR; i++) {
+            __m256 av = _mm256_set1_ps(a[i]);
+            acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_mul_ps(av, b0));
+            acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_mul_ps(av, b1));
+        }
+        a += MR;
+        b += NR;
+    }
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; i++) {
+            float* c = C + size_t(i) * ldc;
+            _mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), acc[i][0]));
+            _mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), acc[i][1]));
+        }
+        return;
+    }
+    alignas(64) float out[MR * NR];
+    for (int i = 0; i < MR; i++) {
+        _mm256_store_ps(out + i * NR, acc[i][0]);
+        _mm256_store_ps(out + i * NR + 8, acc[i][1]);
+    }
+    addBlock(out, C, ldc, mr, nr);
+}
+
+// ---- AVX-512: one 512-bit vector per row, masked edges ----
+
+__attribute__((target("avx512f")))
+inline void kernelIntAVX512(int kc, const int* a, const int* b, int* C, size_t ldc, int mr, int nr) {
+    __m512i acc[MR];
+    for (int i = 0; i < MR; i++) acc[i] = _mm512_setzero_si512();
+    for (int k = 0; k < kc; k++) {
+        __m512i bv = _mm512_load_si512(b);
+        for (int i = 0; i < MR; i++)
+            acc[i] = _mm512_add_epi32(acc[i], _mm512_mullo_epi32(_mm512_set1_epi32(a[i]), bv));
+        a += MR;
+        b += NR;
+    }
+    __mmask16 mask = (__mmask16)((1u << nr) - 1);
+    for (int i = 0; i < mr; i++) {
+        int* c = C + size_t(i) * ldc;
+        _mm512_mask_storeu_epi32(c, mask, _mm512_add_epi32(_mm512_maskz_loadu_epi32(mask, c), acc[i]));
+    }
+}
+
+__attribute__((target("avx512f"))) GEMM_NO_CONTRACT
+inline void kernelFloatAVX512(int kc, const float* a, const float* b, float* C, size_t ldc, int mr, int nr) {
+    __m512 acc[MR];
+    for (int i = 0; i < MR; i++) acc[i] = _mm512_setzero_ps();
+    for (int k = 0; k < kc; k++) {
+        __m512 bv = _mm512_load_ps(b);
+        for (int i = 0; i < MR; i++)
+            acc[i] = _mm512_add_ps(acc[i], _mm512_mul_ps(_mm512_set1_ps(a[i]), bv));
+        a += MR;
+        b += NR;
+    }
+    __mmask16 mask = (__mmask16)((1u << nr) - 1);
+    for (int i = 0; i < mr; i++) {
+        float* c = C + size_t(i) * ldc;
+        _mm512_mask_storeu_ps(c, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, c), acc[i]));
+    }
+}
+
+#endif // GEMM_X86
+
+template <typename T> struct KernelTable;
+
+template <> struct KernelTable<int> {
+    static MicroKernel<int> get(Isa isa) {
+#ifdef GEMM_X86
+        switch (isa) {
+        case Isa::SSE4: return kernelIntSSE4;
+        case Isa::AVX2: return kernelIntAVX2;
+        case Isa::AVX512: return kernelIntAVX512;
+        default: break;
+        }
+#endif
+        (void)isa;
+        return kernelScalar<int>;
+    }
+};
+
+template <> struct KernelTable<float> {
+    static MicroKernel<float> get(Isa isa) {
+#ifdef GEMM_X86
+        switch (isa) {
+        case Isa::SSE4: return kernelFloatSSE4;
+        case Isa::AVX2: return kernelFloatAVX2;
+        case Isa::AVX512: return kernelFloatAVX512;
+        default: break;
+        }
+#endif
+        (void)isa;
+        return kernelScalar<float>;
+    }
+};
+
+inline Isa cpuIsa() {
+#ifdef GEMM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+    if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return Isa::SSE4;
+#endif
+    return Isa::Scalar;
+}
+
+inline Isa requestedIsa() {
+    Isa best = cpuIsa();
+    const char* env = std::getenv("GEMM_ISA");
+    if (!env) return best;
+    Isa want = best;
+    if (!std::strcmp(env, "scalar")) want = Isa::Scalar;
+    else if (!std::strcmp(env, "sse4")) want = Isa::SSE4;
+    else if (!std::strcmp(env, "avx2")) want = Isa::AVX2;
+    else if (!std::strcmp(env, "avx512")) want = Isa::AVX512;
+    else std::fprintf(stderr, "GEMM_ISA=%s not recognised, using %s\n", env, isaName(best));
+    if (want > best) {
+        std::fprintf(stderr, "GEMM_ISA=%s not supported by this CPU, using %s\n", env, isaName(best));
+        want = best;
+    }
+    return want;
+}
+
+} // namespace detail
+
+// Run the ISA kernel and the scalar kernel on the same packed panels, covering
+// full and partial register blocks, and require identical output bits.
+template <typename T>
+bool verifyKernel(Isa isa) {
+    const int kc = 67;
+    std::vector<T> a(size_t(MR) * kc), b(size_t(NR) * kc + NR);
+    T* bAligned = b.data();
+    while (reinterpret_cast<size_t>(bAligned) % 64) bAligned++;
+    unsigned seed = 12345;
+    auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return int(seed >> 16) % 201 - 100; };
+    for (auto& v : a) v = T(next()) / T(7);
+    for (int i = 0; i < NR * kc; i++) bAligned[i] = T(next()) / T(3);
+
+    MicroKernel<T> test = detail::KernelTable<T>::get(isa);
+    MicroKernel<T> ref = detail::kernelScalar<T>;
+    const size_t ldc = NR + 3;
+    for (int mr = 1; mr <= MR; mr++) {
+        for (int nr = 1; nr <= NR; nr++) {
+            std::vector<T> c1(MR * ldc, T(1)), c2(MR * ldc, T(1));
+            test(kc, a.data(), bAligned, c1.data(), ldc, mr, nr);
+            ref(kc, a.data(), bAligned, c2.data(), ldc, mr, nr);
+            if (std::memcmp(c1.data(), c2.data(), c1.size() * sizeof(T)) != 0) return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+struct Dispatch {
+    Isa isa;
+    MicroKernel<T> kernel;
+
+    Dispatch() {
+        isa = detail::requestedIsa();
+        while (isa != Isa::Scalar && !verifyKernel<T>(isa)) {
+            std::fprintf(stderr, "GEMM %s kernel failed bit-exact check, falling back\n", isaName(isa));
+            isa = Isa(int(isa) - 1);
+        }
+        kernel = detail::KernelTable<T>::get(isa);
+    }
+
+    static const Dispatch& instance() {
+        static const Dispatch d;
+        return d;
+    }
+};
+
+// Selected micro-kernel for T. Types without a SIMD kernel use the scalar one.
+template <typename T>
+inline MicroKernel<T> microKernel() { return detail::kernelScalar<T>; }
+template <>
+inline MicroKernel<int> microKernel<int>() { return Dispatch<int>::instance().kernel; }
+template <>
+inline MicroKernel<float> microKernel<float>() { return Dispatch<float>::instance().kernel; }
+
+template <typename T>
+inline Isa selectedIsa() { return Isa::Scalar; }
+template <>
+inline Isa selectedIsa<int>() { return Dispatch<int>::instance().isa; }
+template <>
+inline Isa selectedIsa<float>() { return Dispatch<float>::instance().isa; }
+
+} // namespace gemm
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SIT315_GEMM_PARALLEL_H
+#define SIT315_GEMM_PARALLEL_H
+
+// Parallel drivers for the blocked GEMM in matrix.h: one on the pthread
+// ThreadPool (2-D output tiles, work stealing) and one on OpenMP (row blocks
+// of at most MC, dynamic schedule), plus multiplyScheduled() for the same
+// row blocks under any schedule from omp_schedule.h. Compile with -fopenmp
+// for the OpenMP drivers to run in parallel; without it they run serially.
+
+#include <algorithm>
+
+#include "matrix.h"
+#include "omp_schedule.h"
+#include "thread_pool.h"
+
+namespace gemm {
+
+// Output tile handed to one pool worker
+struct TileSizes {
+    int rows = 128;
+    int cols = 512;
+};
+
+// Tiles of at most MC x 512 (rounded to the MR x NR register block), halved
+// along the longer side until there are `perWorker` tiles for each worker,
+// so small products still spread over the pool and leave work to steal
+inline TileSizes tileSizesFor(int m, int n, int workers, const BlockSizes& bs = BlockSizes(), int perWorker = 4) {
+    TileSizes ts;
+    ts.rows = std::max(MR, (std::min(bs.mc, m) + MR - 1) / MR * MR);
+    ts.cols = std::max(NR, (std::min(ts.cols, n) + NR - 1) / NR * NR);
+    const long want = long(std::max(workers, 1)) * perWorker;
+    while (long((m + ts.rows - 1) / ts.rows) * ((n + ts.cols - 1) / ts.cols) < want) {
+        bool splitRows = ts.rows / MR >= ts.cols / NR;
+        if (splitRows && ts.rows > MR) ts.rows = ((ts.rows / 2) + MR - 1) / MR * MR;
+        else if (ts.cols > NR) ts.cols = ((ts.cols / 2) + NR - 1) / NR * NR;
+        else if (ts.rows > MR) ts.rows = ((ts.rows / 2) + MR - 1) / MR * MR;
+        else break;
+    }
+    return ts;
+}
+
+template <typename T>
+void multiplyPool(ThreadPool& pool, const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C,
+                  const BlockSizes& bs, const TileSizes& ts) {
+    const int m = C.rows(), n = C.cols();
+    const int tileRows = (m + ts.rows - 1) / ts.rows;
+    const int tileCols = (n + ts.cols - 1) / ts.cols;
+    pool.run(tileRows * tileCols, [&](int tile) {
+        int row = (tile / tileCols) * ts.rows;
+        int col = (tile % tileCols) * ts.cols;
+        multiplyTile(A, B, C, row, std::min(row + ts.rows, m), col, std::min(col + ts.cols, n), bs);
+    });
+}
+
+// Tile sizes from tileSizesFor() for this product and pool
+template <typename T>
+void multiplyPool(ThreadPool& pool, const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C,
+                  const BlockSizes& bs = BlockSizes()) {
+    multiplyPool(pool, A, B, C, bs, tileSizesFor(C.rows(), C.cols(), pool.size(), bs));
+}
+
+// Height of the row blocks the OpenMP drivers hand out: MC, capped at an
+// even share of the m rows (rounded up to MR) so that a small product still
+// has a block for every thread
+inline int rowBlock(int m, int threads, const BlockSizes& bs) {
+    threads = std::max(threads, 1);
+    int share = ((m + threads - 1) / threads + MR - 1) / MR * MR;
+    return std::max(MR, std::min(bs.mc, share));
+}
+
+template <typename T>
+void multiplyOpenMP(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C, int numThreads,
+                    const BlockSizes& bs = BlockSizes()) {
+    const int m = C.rows();
+    const int mb = rowBlock(m, numThreads, bs);
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (int i = 0; i < m; i += mb) {
+        multiplyRows(A, B, C, i, std::min(i + mb, m), bs);
+    }
+}
+
+// One work unit per row block (see rowBlock); loop.busy shows how evenly
+// they spread
+template <typename T>
+void multiplyScheduled(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C, sched_loop& loop,
+                       const BlockSizes& bs = BlockSizes()) {
+    loop.grain = rowBlock(C.rows(), sched_max_threads(&loop), bs);
+    runScheduled(loop, C.rows(), [&](long begin, long end) { multiplyRows(A, B, C, int(begin), int(end), bs); });
+}
+
+} // namespace gemm
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef SIT315_GEMM_TUNING_H
+#define SIT315_GEMM_TUNING_H
+
+// Tuning cache for the GEMM programs. codes/GemmAutotune.cpp benchmarks
+// block sizes, thread counts and backends for a shape on the current machine
+// and stores the winners here; the matrix programs load the cache at startup
+// and use the entry for their backend that is closest to their shape.
+//
+// The cache is a text file, one entry per line:
+//   m n k dtype backend mc kc nc threads gflops
+// Its path is $GEMM_TUNING_CACHE, or gemm_tuning.cache in the working directory.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "matrix.h"
+
+namespace gemm {
+
+struct TuningEntry {
+    int m = 0, n = 0, k = 0;
+    std::string dtype;     // "int" or "float"
+    std::string backend;   // "sequential", "pthread" or "openmp"
+    BlockSizes blocks;
+    int threads = 1;
+    double gflops = 0.0;
+
+    // Usable by the GEMM drivers: positive sizes, block sizes on the MR x NR
+    // register block (mc = 0 would never advance the row loop), and at least
+    // one thread
+    bool valid() const {
+        return m > 0 && n > 0 && k > 0 && blocks.mc > 0 && blocks.mc % MR == 0 && blocks.kc > 0 &&
+               blocks.nc > 0 && blocks.nc % NR == 0 && threads >= 1;
+    }
+
+    bool sameKey(const TuningEntry& o) const {
+        return m == o.m && n == o.n && k == o.k && dtype == o.dtype && backend == o.backend;
+    }
+};
+
+inline std::string tuningCachePath() {
+    const char* env = std::getenv("GEMM_TUNING_CACHE");
+    return env && *env ? env : "gemm_tuning.cache";
+}
+
+class TuningCache {
+public:
+    // Missing or unreadable files simply give an empty cache; malformed or
+    // invalid lines (e.g. hand-edited to mc=0) are skipped with a warning
+    bool load(const std::string& path = tuningCachePath()) {
+        entries_.clear();
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream fields(line);
+            TuningEntry e;
+            if (fields >> e.m >> e.n >> e.k >> e.dtype >> e.backend >> e.blocks.mc >> e.blocks.kc >> e.blocks.nc
+                       >> e.threads >> e.gflops && e.valid())
+                entries_.push_back(e);
+            else
+                std::fprintf(stderr, "%s: ignoring invalid entry \"%s\"\n", path.c_str(), line.c_str());
+        }
+        return true;
+    }
+
+    bool save(const std::string& path = tuningCachePath()) const {
+        std::ofstream out(path);
+        if (!out) return false;
+        out << "# m n k dtype backend mc kc nc threads gflops\n";
+        for (const auto& e : entries_)
+            out << e.m << ' ' << e.n << ' ' << e.k << ' ' << e.dtype << ' ' << e.backend << ' '
+                << e.blocks.mc << ' ' << e.blocks.kc << ' ' << e.blocks.nc << ' '
+                << e.threads << ' ' << e.gflops << '\n';
+        return bool(out);
+    }
+
+    // Insert or replace the entry with the same shape, dtype and backend
+    void update(const TuningEntry& entry) {
+        for (auto& e : entries_) {
+            if (e.sameKey(entry)) {
+                e = entry;
+                return;
+            }
+        }
+        entries_.push_back(entry);
+    }
+
+    // Entry for dtype whose shape is closest (in log space) to m x n x k.
+    // An empty backend matches any backend and prefers the fastest one.
+    const TuningEntry* lookup(int m, int n, int k, const std::string& dtype,
+                              const std::string& backend = "") const {
+        const TuningEntry* best = nullptr;
+        double bestDist = 0.0;
+        for (const auto& e : entries_) {
+            if (e.dtype != dtype || (!backend.empty() && e.backend != backend)) continue;
+            double dist = std::fabs(std::log(double(e.m) / m)) + std::fabs(std::log(double(e.n) / n)) +
+                          std::fabs(std::log(double(e.k) / k));
+            if (!best || dist < bestDist - 1e-9 || (std::fabs(dist - bestDist) <= 1e-9 && e.gflops > best->gflops)) {
+                best = &e;
+                bestDist = dist;
+            }
+        }
+        return best;
+    }
+
+    const std::vector<TuningEntry>& entries() const { return entries_; }
+
+private:
+    std::vector<TuningEntry> entries_;
+};
+
+} // namespace gemm
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef SIT315_KWAY_MERGE_H
+#define SIT315_KWAY_MERGE_H
+
+// k-way merge of sorted int runs with a loser (tournament) tree.
+//
+// Internal node i of the tree holds the run that lost the match played
+// there, node 0 the overall winner. Taking a key from the winner replays
+// only the matches on its leaf-to-root path, so each output key costs
+// ceil(log2 k) comparisons against the cached run heads, and all runs are
+// merged in one streaming pass with no intermediate copies. Equal keys come
+// out in run order, so the merge is stable.
+//
+// A run is a sequence of buffers. Runs held in memory pass their whole data
+// as the first buffer; runs read from elsewhere (files, sockets) pass the
+// first block and a refill callback that supplies the next one when a
+// buffer is used up. Output is produced in blocks by kway_merge_next(), so
+// neither side has to fit in memory.
+//
+// Plain C, usable from both the C and C++ programs.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Point *data at the next buffer of `run` and return its length, or 0 when
+// the run is exhausted. The buffer must stay valid until the next refill of
+// the same run.
+typedef size_t (*kway_refill_fn)(void *ctx, int run, const int **data);
+
+// Head key of an exhausted run; orders after every int
+#define KWAY_EXHAUSTED INT64_MAX
+
+typedef struct {
+    int k;
+    int *tree;              // tree[0] = winner run, tree[1..k) = losers
+    int64_t *head;          // current key of each run
+    const int **pos;        // next key of each run after its head
+    const int **end;
+    kway_refill_fn refill;
+    void *ctx;
+} kway_merge;
+
+// Load the head of run r from its buffer, refilling it if it is used up
+static inline void kway_load_head(kway_merge *m, int r) {
+    if (m->pos[r] == m->end[r] && m->refill) {
+        const int *data = NULL;
+        size_t len = m->refill(m->ctx, r, &data);
+        m->pos[r] = data;
+        m->end[r] = data + len;
+    }
+    m->head[r] = m->pos[r] < m->end[r] ? *m->pos[r]++ : KWAY_EXHAUSTED;
+}
+
+// Does run a win against run b (smaller head, ties to the lower run)?
+static inline int kway_beats(const kway_merge *m, int a, int b) {
+    return m->head[a] < m->head[b] || (m->head[a] == m->head[b] && a < b);
+}
+
+// Start merging k runs whose first buffers are runs[r][0..lens[r]). refill
+// may be NULL when every run is fully in memory. Returns 0 on success.
+static inline int kway_merge_init(kway_merge *m, int k, const int *const *runs, const size_t *lens,
+                                  kway_refill_fn refill, void *ctx) {
+    m->k = k;
+    m->refill = refill;
+    m->ctx = ctx;
+    m->tree = (int *)malloc((k > 0 ? k : 1) * sizeof(int));
+    m->head = (int64_t *)malloc((k > 0 ? k : 1) * sizeof(int64_t));
+    m->pos = (const int **)malloc((k > 0 ? k : 1) * sizeof(const int *));
+    m->end = (const int **)malloc((k > 0 ? k : 1) * sizeof(const int *));
+    int *winner = (int *)malloc(2 * (k > 0 ? k : 1) * sizeof(int));
+    if (!m->tree || !m->head || !m->pos || !m->end || !winner) {
+        free(m->tree);
+        free(m->head);
+        free(m->pos);
+        free(m->end);
+        free(winner);
+        m->tree = NULL;
+        m->head = NULL;
+        m->pos = NULL;
+        m->end = NULL;
+        m->k = 0;
+        return -1;
+    }
+
+    for (int r = 0; r < k; r++) {
+        m->pos[r] = runs[r];
+        m->end[r] = runs[r] + lens[r];
+        kway_load_head(m, r);
+    }
+
+    // Leaves are nodes k..2k-1; play every match bottom-up once
+    for (int r = 0; r < k; r++) winner[k + r] = r;
+    for (int i = k - 1; i >= 1; i--) {
+        int a = winner[2 * i], b = winner[2 * i + 1];
+        if (kway_beats(m, a, b)) {
+            winner[i] = a;
+            m->tree[i] = b;
+        } else {
+            winner[i] = b;
+            m->tree[i] = a;
+        }
+    }
+    m->tree[0] = k > 1 ? winner[1] : 0;
+    free(winner);
+    return 0;
+}
+
+// Write up to cap merged keys to out; returns how many, 0 once all runs are
+// exhausted
+static inline size_t kway_merge_next(kway_merge *m, int *out, size_t cap) {
+    const int k = m->k;
+    size_t count = 0;
+    if (k == 0) return 0;
+    int w = m->tree[0];
+    while (count < cap && m->head[w] != KWAY_EXHAUSTED) {
+        out[count++] = (int)m->head[w];
+        kway_load_head(m, w);
+        // Replay the winner's path; the loser of each match stays behind
+        for (int i = (k + w) >> 1; i > 0; i >>= 1) {
+            int other = m->tree[i];
+            if (kway_beats(m, other, w)) {
+                m->tree[i] = w;
+                w = other;
+            }
+        }
+    }
+    m->tree[0] = w;
+    return count;
+}
+
+static inline void kway_merge_free(kway_merge *m) {
+    free(m->tree);
+    free(m->head);
+    free(m->pos);
+    free(m->end);
+    m->tree = NULL;
+    m->head = NULL;
+    m->pos = NULL;
+    m->end = NULL;
+    m->k = 0;
+}
+
+// Merge k in-memory runs data[displs[r] .. displs[r] + counts[r]) into out,
+// the layout MPI_Gatherv / MPI_Alltoallv leave them in. Returns 0 on success.
+static inline int kway_merge_runs(const int *data, const int *counts, const int *displs, int k, int *out) {
+    const int **runs = (const int **)malloc((k > 0 ? k : 1) * sizeof(const int *));
+    size_t *lens = (size_t *)malloc((k > 0 ? k : 1) * sizeof(size_t));
+    size_t total = 0;
+    kway_merge m;
+    int ok = runs && lens;
+    if (ok) {
+        for (int r = 0; r < k; r++) {
+            runs[r] = data + displs[r];
+            lens[r] = (size_t)counts[r];
+            total += lens[r];
+        }
+        ok = kway_merge_init(&m, k, runs, lens, NULL, NULL) == 0;
+    }
+    if (ok) {
+        kway_merge_next(&m, out, total);
+        kway_merge_free(&m);
+    }
+    free(runs);
+    free(lens);
+    return ok ? 0 : -1;
+}
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef SIT315_MATRIX_H
+#define SIT315_MATRIX_H
+
+// Shared dense matrix type and cache-blocked GEMM used by the programs in codes/.
+// Header-only so each program still builds with a single compiler command, e.g.
+//   g++ -O3 -march=native -fopenmp -I../common OpenMPversion.cpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#include "gemm_kernels.h"
+#include "numa_alloc.h"
+
+// Matrix stored row-major in one contiguous buffer. The row stride is padded
+// to a whole cache line so every row starts 64-byte aligned. wrap() builds a
+// non-owning Matrix over existing storage (e.g. a memory-mapped file), whose
+// stride may be unpadded; copies of it own their storage again. Storage comes
+// from numa_alloc.h and is zeroed by an OpenMP static loop over rows, so on a
+// multi-socket machine each thread's rows start out on its own node.
+template <typename T>
+class Matrix {
+public:
+    static const size_t ALIGNMENT = 64;
+
+    Matrix() : rows_(0), cols_(0), stride_(0), data_(nullptr), owned_(true) {}
+
+    Matrix(int rows, int cols)
+        : rows_(rows), cols_(cols), stride_(paddedStride(cols)), data_(nullptr), owned_(true) {
+        data_ = allocate(size_t(rows_) * stride_);
+        T* data = data_;
+        const size_t stride = stride_;
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < rows_; i++) std::fill(data + size_t(i) * stride, data + size_t(i + 1) * stride, T(0));
+    }
+
+    Matrix(const Matrix& other) : Matrix(other.rows_, other.cols_) {
+        for (int i = 0; i < rows_; i++) std::copy(other.row(i), other.row(i) + cols_, row(i));
+    }
+
+    Matrix(Matrix&& other) noexcept
+        : rows_(other.rows_), cols_(other.cols_), stride_(other.stride_), data_(other.data_), owned_(other.owned_) {
+        other.rows_ = other.cols_ = 0;
+        other.stride_ = 0;
+        other.data_ = nullptr;
+        other.owned_ = true;
+    }
+
+    static Matrix wrap(T* data, int rows, int cols, size_t stride) {
+        Matrix m;
+        m.rows_ = rows;
+        m.cols_ = cols;
+        m.stride_ = stride;
+        m.data_ = data;
+        m.owned_ = false;
+        return m;
+    }
+
+    Matrix& operator=(Matrix other) noexcept {
+        std::swap(rows_, other.rows_);
+        std::swap(cols_, other.cols_);
+        std::swap(stride_, other.stride_);
+        std::swap(data_, other.data_);
+        std::swap(owned_, other.owned_);
+        return *this;
+    }
+
+    ~Matrix() {
+        if (owned_ && data_) numa_buffer_free(data_, allocationBytes(size_t(rows_) * stride_));
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    size_t stride() const { return stride_; }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+
+    T* row(int i) { return data_ + size_t(i) * stride_; }
+    const T* row(int i) const { return data_ + size_t(i) * stride_; }
+
+    T& operator()(int i, int j) { return data_[size_t(i) * stride_ + j]; }
+    const T& operator()(int i, int j) const { return data_[size_t(i) * stride_ + j]; }
+
+    void fill(T value) {
+        for (int i = 0; i < rows_; i++) std::fill(row(i), row(i) + cols_, value);
+    }
+
+private:
+    static size_t paddedStride(int cols) {
+        const size_t per_line = ALIGNMENT / sizeof(T);
+        return (size_t(cols) + per_line - 1) / per_line * per_line;
+    }
+
+    static size_t allocationBytes(size_t count) { return std::max<size_t>(count, 1) * sizeof(T); }
+
+    static T* allocate(size_t count) {
+        void* p = numa_buffer_alloc(allocationBytes(count), 0);
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    int rows_, cols_;
+    size_t stride_;
+    T* data_;
+    bool owned_;
+};
+
+namespace gemm {
+
+// Cache blocking around the MR x NR register block of gemm_kernels.h: an
+// MC x KC block of A stays in L2, a KC x NR panel of B in L1, and the packed
+// KC x NC slab of B in L3.
+struct BlockSizes {
+    int mc = 128;
+    int kc = 256;
+    int nc = 2048;
+};
+
+// Simple owning aligned scratch buffer for packed panels.
+template <typename T>
+struct PackBuffer {
+    T* ptr = nullptr;
+    size_t size = 0;
+
+    ~PackBuffer() { std::free(ptr); }
+
+    T* get(size_t count) {
+        if (count > size) {
+            std::free(ptr);
+            size_t bytes = (count * sizeof(T) + 63) / 64 * 64;
+            ptr = static_cast<T*>(std::aligned_alloc(64, bytes));
+            if (!ptr) throw std::bad_alloc();
+            size = count;
+        }
+        return ptr;
+    }
+};
+
+// Pack a kc x nc block of B into column panels of width NR. Each panel is laid
+// out k-major (NR contiguous values per k) and zero padded on the right edge.
+template <typename T>
+void packB(const T* B, size_t ldb, int kc, int nc, T* out) {
+    for (int j0 = 0; j0 < nc; j0 += NR) {
+        int nr = std::min(NR, nc - j0);
+        for (int k = 0; k < kc; k++) {
+            const T* src = B + size_t(k) * ldb + j0;
+            for (int j = 0; j < nr; j++) out[j] = src[j];
+            for (int j = nr; j < NR; j++) out[j] = T(0);
+            out += NR;
+        }
+    }
+}
+
+// Pack an mc x kc block of A into row panels of height MR, k-major, zero padded.
+template <typename T>
+void packA(const T* A, size_t lda, int mc, int kc, T* out) {
+    for (int i0 = 0; i0 < mc; i0 += MR) {
+        int mr = std::min(MR, mc - i0);
+        for (int k = 0; k < kc; k++) {
+            for (int i = 0; i < mr; i++) out[i] = A[size_t(i0 + i) * lda + k];
+            for (int i = mr; i < MR; i++) out[i] = T(0);
+            out += MR;
+        }
+    }
+}
+
+// C[m x n] (+)= A[m x k] * B[k x n] on raw row-major storage with leading
+// dimensions. When accumulate is false C is overwritten.
+template <typename T>
+void multiply(const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc,
+              int m, int n, int k, bool accumulate = false, const BlockSizes& bs = BlockSizes()) {
+    if (!accumulate)
+        for (int i = 0; i < m; i++) std::fill(C + size_t(i) * ldc, C + size_t(i) * ldc + n, T(0));
+    if (m == 0 || n == 0 || k == 0) return;
+
+    thread_local PackBuffer<T> bufA, bufB;
+    const int mcMax = (std::min(bs.mc, m) + MR - 1) / MR * MR;
+    const int ncMax = (std::min(bs.nc, n) + NR - 1) / NR * NR;
+    T* packedA = bufA.get(size_t(mcMax) * bs.kc);
+    T* packedB = bufB.get(size_t(ncMax) * bs.kc);
+    const MicroKernel<T> kernel = microKernel<T>();
+
+    for (int jc = 0; jc < n; jc += bs.nc) {
+        int nc = std::min(bs.nc, n - jc);
+        for (int pc = 0; pc < k; pc += bs.kc) {
+            int kc = std::min(bs.kc, k - pc);
+            packB(B + size_t(pc) * ldb + jc, ldb, kc, nc, packedB);
+            for (int ic = 0; ic < m; ic += bs.mc) {
+                int mc = std::min(bs.mc, m - ic);
+                packA(A + size_t(ic) * lda + pc, lda, mc, kc, packedA);
+                for (int jr = 0; jr < nc; jr += NR) {
+                    int nr = std::min(NR, nc - jr);
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        int mr = std::min(MR, mc - ir);
+                        kernel(kc, packedA + size_t(ir) * kc, packedB + size_t(jr) * kc,
+                               C + size_t(ic + ir) * ldc + jc + jr, ldc, mr, nr);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Compute the output tile C[rowBegin:rowEnd, colBegin:colEnd] of C = A * B.
+// Disjoint tiles can be computed concurrently from different threads.
+template <typename T>
+void multiplyTile(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C,
+                  int rowBegin, int rowEnd, int colBegin, int colEnd,
+                  const BlockSizes& bs = BlockSizes()) {
+    multiply(A.row(rowBegin), A.stride(),
+             B.data() + colBegin, B.stride(),
+             C.row(rowBegin) + colBegin, C.stride(),
+             rowEnd - rowBegin, colEnd - colBegin, A.cols(), false, bs);
+}
+
+// C = A * B for rows [rowBegin, rowEnd) of C.
+template <typename T>
+void multiplyRows(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C,
+                  int rowBegin, int rowEnd, const BlockSizes& bs = BlockSizes()) {
+    multiplyTile(A, B, C, rowBegin, rowEnd, 0, B.cols(), bs);
+}
+
+template <typename T>
+Matrix<T> multiply(const Matrix<T>& A, const Matrix<T>& B, const BlockSizes& bs = BlockSizes()) {
+    Matrix<T> C(A.rows(), B.cols());
+    multiplyRows(A, B, C, 0, A.rows(), bs);
+    return C;
+}
+
+} // namespace gemm
+
+#endif
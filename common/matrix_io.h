@@ -0,0 +1,241 @@
+#ifndef SIT315_MATRIX_IO_H
+#define SIT315_MATRIX_IO_H
+
+// Compact binary matrix files.
+//
+// A 64-byte header (magic "SMAT", version, dtype, endianness marker, rows,
+// cols, data offset) is followed by the rows x cols elements, row-major, with
+// no separators. Files are written in one gathered write and read back
+// zero-copy through mmap; the payload starts 64 bytes into the file, so the
+// mapped data is cache-line aligned.
+//
+// The C API is used by the C programs (heat_sim.c, tools/matrix2txt.c); C++
+// callers also get saveMatrix() / MappedMatrix for Matrix<T>.
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define MATRIX_FILE_MAGIC "SMAT"
+#define MATRIX_FILE_VERSION 1u
+#define MATRIX_FILE_ENDIAN 0x01020304u
+#define MATRIX_FILE_DATA_OFFSET 64u
+
+enum matrix_dtype {
+    MATRIX_INT32 = 1,
+    MATRIX_FLOAT32 = 2,
+    MATRIX_FLOAT64 = 3
+};
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t dtype;
+    uint32_t endian;        // MATRIX_FILE_ENDIAN in the writer's byte order
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t data_offset;
+    uint8_t reserved[24];
+} matrix_file_header;
+
+typedef struct {
+    void *base;
+    size_t length;
+    const matrix_file_header *header;
+    void *data;             // rows x cols elements, contiguous
+} matrix_mapping;
+
+static inline size_t matrix_dtype_size(uint32_t dtype) {
+    switch (dtype) {
+    case MATRIX_INT32: return 4;
+    case MATRIX_FLOAT32: return 4;
+    case MATRIX_FLOAT64: return 8;
+    default: return 0;
+    }
+}
+
+static inline const char *matrix_dtype_name(uint32_t dtype) {
+    switch (dtype) {
+    case MATRIX_INT32: return "int32";
+    case MATRIX_FLOAT32: return "float32";
+    case MATRIX_FLOAT64: return "float64";
+    default: return "unknown";
+    }
+}
+
+// Write rows x cols elements. row_stride is the distance between rows in
+// bytes (0 for densely packed data). Returns 0 on success, -1 on error.
+static inline int matrix_write(const char *path, uint32_t dtype, size_t rows, size_t cols,
+                               const void *data, size_t row_stride) {
+    size_t elem = matrix_dtype_size(dtype);
+    size_t row_bytes = cols * elem;
+    if (elem == 0) return -1;
+    if (row_stride == 0) row_stride = row_bytes;
+
+    matrix_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_FILE_MAGIC, 4);
+    header.version = MATRIX_FILE_VERSION;
+    header.dtype = dtype;
+    header.endian = MATRIX_FILE_ENDIAN;
+    header.rows = rows;
+    header.cols = cols;
+    header.data_offset = MATRIX_FILE_DATA_OFFSET;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+
+    // Dense data goes out with the header in a single writev; padded rows are
+    // gathered in batches so the kernel still sees a few large writes
+    enum { BATCH = 1024 };
+    struct iovec iov[BATCH];
+    int count = 0, ok = 1;
+    iov[count].iov_base = &header;
+    iov[count++].iov_len = sizeof(header);
+    size_t dense_rows = row_stride == row_bytes ? rows : 0;
+    if (dense_rows > 0 && row_bytes > 0) {
+        iov[count].iov_base = (void *)data;
+        iov[count++].iov_len = rows * row_bytes;
+    }
+    for (size_t r = dense_rows; r <= rows && ok; r++) {
+        if (r < rows && row_bytes > 0) {
+            iov[count].iov_base = (char *)data + r * row_stride;
+            iov[count++].iov_len = row_bytes;
+        }
+        if (count == BATCH || (r == rows && count > 0)) {
+            for (int i = 0; i < count && ok; ) {
+                ssize_t n = writev(fd, iov + i, count - i);
+                if (n < 0) { ok = 0; break; }
+                // Advance past whatever was written (handles short writes)
+                while (i < count && (size_t)n >= iov[i].iov_len) n -= (ssize_t)iov[i++].iov_len;
+                if (i < count) {
+                    iov[i].iov_base = (char *)iov[i].iov_base + n;
+                    iov[i].iov_len -= (size_t)n;
+                }
+            }
+            count = 0;
+        }
+    }
+    if (close(fd) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+// Map a matrix file. The mapping is private and writable (copy-on-write), so
+// callers may treat the data as an ordinary buffer. Returns 0 on success.
+static inline int matrix_map(const char *path, matrix_mapping *m) {
+    memset(m, 0, sizeof(*m));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "matrix_map: cannot open %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(matrix_file_header)) {
+        fprintf(stderr, "matrix_map: %s is not a matrix file\n", path);
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "matrix_map: mmap of %s failed\n", path);
+        return -1;
+    }
+    const matrix_file_header *h = (const matrix_file_header *)base;
+    const char *error = NULL;
+    if (memcmp(h->magic, MATRIX_FILE_MAGIC, 4) != 0 || h->version != MATRIX_FILE_VERSION)
+        error = "bad magic or version";
+    else if (h->endian != MATRIX_FILE_ENDIAN)
+        error = "written with the other byte order";
+    else if (matrix_dtype_size(h->dtype) == 0)
+        error = "unknown dtype";
+    else if (h->rows > INT_MAX || h->cols > INT_MAX)
+        error = "dimensions too large";
+    else if (h->data_offset < sizeof(matrix_file_header) || h->data_offset % MATRIX_FILE_DATA_OFFSET != 0)
+        error = "bad data offset";
+    else {
+        // rows * cols * size checked for overflow, so a crafted header cannot
+        // wrap round and pass the size check
+        uint64_t payload;
+        if (__builtin_mul_overflow(h->rows, h->cols, &payload) ||
+            __builtin_mul_overflow(payload, (uint64_t)matrix_dtype_size(h->dtype), &payload) ||
+            h->data_offset > (uint64_t)st.st_size || payload > (uint64_t)st.st_size - h->data_offset)
+            error = "truncated";
+    }
+    if (error) {
+        fprintf(stderr, "matrix_map: %s: %s\n", path, error);
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+    m->base = base;
+    m->length = (size_t)st.st_size;
+    m->header = h;
+    m->data = (char *)base + h->data_offset;
+    return 0;
+}
+
+static inline void matrix_unmap(matrix_mapping *m) {
+    if (m->base) munmap(m->base, m->length);
+    memset(m, 0, sizeof(*m));
+}
+
+#ifdef __cplusplus
+
+#include <stdexcept>
+#include <string>
+
+#include "matrix.h"
+
+template <typename T> struct MatrixDtype;
+template <> struct MatrixDtype<int> { static const uint32_t value = MATRIX_INT32; };
+template <> struct MatrixDtype<float> { static const uint32_t value = MATRIX_FLOAT32; };
+template <> struct MatrixDtype<double> { static const uint32_t value = MATRIX_FLOAT64; };
+
+// Write a Matrix<T> (padded rows are skipped) in the binary format
+template <typename T>
+bool saveMatrix(const Matrix<T>& matrix, const std::string& path) {
+    return matrix_write(path.c_str(), MatrixDtype<T>::value, matrix.rows(), matrix.cols(),
+                        matrix.data(), matrix.stride() * sizeof(T)) == 0;
+}
+
+// A matrix file mapped into memory; view() wraps the mapped elements in a
+// non-owning Matrix without copying them, valid while the MappedMatrix lives.
+// Throws std::runtime_error on open or format errors.
+template <typename T>
+class MappedMatrix {
+public:
+    explicit MappedMatrix(const std::string& path) {
+        if (matrix_map(path.c_str(), &mapping_) != 0)
+            throw std::runtime_error("cannot map matrix file " + path);
+        if (mapping_.header->dtype != MatrixDtype<T>::value) {
+            std::string found = matrix_dtype_name(mapping_.header->dtype);
+            matrix_unmap(&mapping_);
+            throw std::runtime_error(path + " holds " + found + " elements");
+        }
+    }
+
+    ~MappedMatrix() { matrix_unmap(&mapping_); }
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    int rows() const { return int(mapping_.header->rows); }
+    int cols() const { return int(mapping_.header->cols); }
+
+    Matrix<T> view() const {
+        return Matrix<T>::wrap(static_cast<T*>(mapping_.data), rows(), cols(), size_t(cols()));
+    }
+
+private:
+    matrix_mapping mapping_;
+};
+
+#endif // __cplusplus
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SIT315_MPI_PARTITION_H
+#define SIT315_MPI_PARTITION_H
+
+// Block partitioning of n items over p ranks for MPI_Scatterv / MPI_Gatherv.
+// Rank r owns items [partition_start(n, p, r), partition_start(n, p, r + 1)),
+// so sizes differ by at most one and any n works with any rank count.
+// Plain C, usable from both the C and C++ programs.
+
+static inline int partition_start(int n, int p, int r) {
+    return (int)((long long)r * n / p);
+}
+
+static inline int partition_count(int n, int p, int r) {
+    return partition_start(n, p, r + 1) - partition_start(n, p, r);
+}
+
+// Rank owning item k
+static inline int partition_owner(int k, int n, int p) {
+    return (int)(((long long)p * (k + 1) - 1) / n);
+}
+
+// Element counts and displacements for every rank, where each item is `unit`
+// consecutive elements (e.g. unit = N for rows of an N-column matrix)
+static inline void partition_counts(int n, int p, int unit, int *counts, int *displs) {
+    for (int r = 0; r < p; r++) {
+        counts[r] = partition_count(n, p, r) * unit;
+        displs[r] = partition_start(n, p, r) * unit;
+    }
+}
+
+#endif
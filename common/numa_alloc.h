@@ -0,0 +1,188 @@
+#ifndef SIT315_NUMA_ALLOC_H
+#define SIT315_NUMA_ALLOC_H
+
+// NUMA-aware allocation for large arrays.
+//
+// Linux puts a page on the NUMA node of the thread that first writes it, so
+// malloc followed by a single-threaded fill places a whole array on one node,
+// and threads on the other socket then stream it over the interconnect.
+// numa_buffer_alloc() returns large buffers as fresh, untouched anonymous
+// memory. The first parallel loop that writes them decides the placement.
+// That loop can be a static-schedule OpenMP fill such as rng_fill_* or
+// numa_first_touch(), or per-thread numa_first_touch_part() calls in pthread
+// programs; of these, only the numa_first_touch* calls zero the buffer.
+// Later loops with the same static split then find their pages on the local
+// node. Pin the threads so they do not migrate away from their pages:
+// numa_pin_openmp_threads(), numa_pin_thread() in a pthread worker
+// (ThreadPool does this when asked to pin), or OMP_PROC_BIND=close
+// OMP_PLACES=cores.
+//
+// Environment overrides:
+//   NUMA_POLICY=first-touch|interleave  interleave spreads the pages round
+//                                       robin over all nodes (mbind), for
+//                                       data every thread reads
+//   NUMA_HUGEPAGES=0|1                  madvise(MADV_HUGEPAGE) large buffers
+//                                       (default 1; THP must be in madvise
+//                                       or always mode)
+//   NUMA_PIN=0|1                        let numa_pin_openmp_threads() pin
+//                                       (default 0, since ranks sharing a
+//                                       node would all pin to the same CPUs)
+//
+// Plain C for Linux, usable from the C and C++ programs; no libnuma needed.
+// On a single-node machine it still gives aligned, huge-page backed memory.
+// C programs must include it before any system header (or define
+// _GNU_SOURCE) for the CPU affinity calls.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define NUMA_MIN_BYTES (1u << 20)       // smaller buffers come from aligned_alloc
+#define NUMA_HUGE_PAGE (2u << 20)
+#define NUMA_MAX_NODES 64
+#define NUMA_MPOL_INTERLEAVE 3          // MPOL_INTERLEAVE from <numaif.h>
+
+// Allocation flags; the NUMA_POLICY / NUMA_HUGEPAGES settings apply on top
+#define NUMA_ALLOC_INTERLEAVE 1
+#define NUMA_ALLOC_NO_HUGE 2
+
+static inline int numa_env_flag(const char *name, int fallback) {
+    const char *env = getenv(name);
+    if (!env) return fallback;
+    if (strcmp(env, "0") == 0) return 0;
+    if (strcmp(env, "1") == 0) return 1;
+    fprintf(stderr, "%s=%s not recognised, using %d\n", name, env, fallback);
+    return fallback;
+}
+
+static inline int numa_interleave_requested(void) {
+    const char *env = getenv("NUMA_POLICY");
+    if (!env || strcmp(env, "first-touch") == 0) return 0;
+    if (strcmp(env, "interleave") == 0) return 1;
+    fprintf(stderr, "NUMA_POLICY=%s not recognised, using first-touch\n", env);
+    return 0;
+}
+
+// Bit mask of the nodes in /sys/devices/system/node
+static inline unsigned long numa_node_mask(void) {
+    unsigned long mask = 0;
+    char path[64];
+    for (int node = 0; node < NUMA_MAX_NODES; node++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+        if (access(path, F_OK) == 0) mask |= 1ul << node;
+    }
+    return mask ? mask : 1ul;
+}
+
+static inline int numa_node_count(void) {
+    return __builtin_popcountl(numa_node_mask());
+}
+
+// Bytes actually reserved for a request; numa_buffer_free() must agree
+static inline size_t numa_buffer_size(size_t bytes) {
+    size_t unit = bytes >= NUMA_MIN_BYTES ? NUMA_HUGE_PAGE : 64;
+    if (bytes == 0) bytes = 1;
+    return (bytes + unit - 1) / unit * unit;
+}
+
+// Large buffers are mmap'ed, aligned to a huge page and left untouched;
+// small ones are 64-byte aligned heap memory. Returns NULL on failure.
+static inline void *numa_buffer_alloc(size_t bytes, int flags) {
+    size_t size = numa_buffer_size(bytes);
+    if (bytes < NUMA_MIN_BYTES) return aligned_alloc(64, size);
+
+    // Over-allocate by one huge page and trim, so the buffer is 2 MB aligned
+    size_t span = size + NUMA_HUGE_PAGE;
+    char *raw = (char *)mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    char *p = (char *)(((uintptr_t)raw + NUMA_HUGE_PAGE - 1) & ~(uintptr_t)(NUMA_HUGE_PAGE - 1));
+    if (p > raw) munmap(raw, (size_t)(p - raw));
+    if (raw + span > p + size) munmap(p + size, (size_t)(raw + span - (p + size)));
+
+#ifdef MADV_HUGEPAGE
+    if (!(flags & NUMA_ALLOC_NO_HUGE) && numa_env_flag("NUMA_HUGEPAGES", 1)) madvise(p, size, MADV_HUGEPAGE);
+#endif
+    if ((flags & NUMA_ALLOC_INTERLEAVE) || numa_interleave_requested()) {
+        unsigned long mask = numa_node_mask();
+        if (__builtin_popcountl(mask) > 1 &&
+            syscall(SYS_mbind, p, size, NUMA_MPOL_INTERLEAVE, &mask, (unsigned long)NUMA_MAX_NODES + 1, 0) != 0)
+            perror("mbind");
+    }
+    return p;
+}
+
+// bytes must be the size passed to numa_buffer_alloc()
+static inline void numa_buffer_free(void *p, size_t bytes) {
+    if (!p) return;
+    if (bytes < NUMA_MIN_BYTES) free(p);
+    else munmap(p, numa_buffer_size(bytes));
+}
+
+// Zero slice `part` of `parts` page-aligned slices of the buffer from the
+// calling thread, placing those pages on its node; for pthread workers.
+// Small buffers from aligned_alloc are not zeroed by the allocator, so the
+// whole slice is written, not just one byte per page.
+static inline void numa_first_touch_part(void *p, size_t bytes, int part, int parts) {
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (bytes + page - 1) / page;
+    size_t begin = pages * (size_t)part / (size_t)parts * page, end = pages * (size_t)(part + 1) / (size_t)parts * page;
+    if (end > bytes) end = bytes;
+    if (begin < end) memset((char *)p + begin, 0, end - begin);
+}
+
+// Zero the buffer with a static OpenMP schedule, so thread t owns the pages
+// of the t-th slice, as in any later `parallel for schedule(static)` over it
+static inline void numa_first_touch(void *p, size_t bytes) {
+#ifdef _OPENMP
+    #pragma omp parallel
+    numa_first_touch_part(p, bytes, omp_get_thread_num(), omp_get_num_threads());
+#else
+    numa_first_touch_part(p, bytes, 0, 1);
+#endif
+}
+
+// Bind the calling thread to the index-th CPU it is allowed to run on
+// (wrapping around), so a restricted mask from taskset or mpirun is kept.
+// Returns the CPU, or -1.
+static inline int numa_pin_thread(int index) {
+    cpu_set_t allowed, set;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return -1;
+    int count = CPU_COUNT(&allowed);
+    if (count == 0) return -1;
+    int want = index % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || want-- > 0) continue;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0 ? cpu : -1;
+    }
+    return -1;
+}
+
+// With NUMA_PIN=1, pin OpenMP thread t to the t-th allowed CPU, matching the
+// slices numa_first_touch() gave it. Call before the first touch. Returns the
+// number of threads pinned.
+static inline int numa_pin_openmp_threads(void) {
+    int pinned = 0;
+    if (!numa_env_flag("NUMA_PIN", 0)) return 0;
+#ifdef _OPENMP
+    #pragma omp parallel reduction(+:pinned)
+    pinned += numa_pin_thread(omp_get_thread_num()) >= 0;
+#else
+    pinned = numa_pin_thread(0) >= 0;
+#endif
+    return pinned;
+}
+
+#endif
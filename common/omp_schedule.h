@@ -0,0 +1,291 @@
+#ifndef SIT315_OMP_SCHEDULE_H
+#define SIT315_OMP_SCHEDULE_H
+
+// Loop scheduling for OpenMP loops whose iterations cost different amounts.
+//
+// A sched_loop runs iterations [0, n) of a loop body, `grain` iterations per
+// work unit, with one of these schedules:
+//
+//   static    equal contiguous blocks (or `chunk` units round robin)
+//   dynamic   threads take `chunk` units at a time from a shared counter
+//   guided    like dynamic, with chunks shrinking from n / threads to `chunk`
+//   runtime   whatever OMP_SCHEDULE (or omp_set_schedule) says
+//   adaptive  the first run uses dynamic,1 and times every unit; later runs
+//             give each thread one contiguous range of equal measured cost,
+//             so uneven loops balance without dynamic's per-chunk overhead.
+//             sched_loop_reset() (or a different n) measures again.
+//
+// The first four all compile to one `schedule(runtime)` loop: the kind and
+// chunk are set with omp_set_schedule() just before it, and the caller's
+// setting is restored after it, so they can be chosen at run time without a
+// separate pragma per schedule. After each run,
+// busy[t] holds the seconds thread t spent before running out of work, and
+// sched_report() prints them with the resulting imbalance.
+//
+// Environment override, applied by sched_loop_env():
+//   LOOP_SCHEDULE=kind[,chunk]   replaces the schedule a program asks for,
+//                                e.g. LOOP_SCHEDULE=guided,4
+//
+// Plain C with function-pointer bodies for the C programs; C++ callers also
+// get runScheduled() taking a lambda. Without -fopenmp the loop runs serially.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#include <time.h>
+#endif
+
+enum sched_kind {
+    SCHED_STATIC,
+    SCHED_DYNAMIC,
+    SCHED_GUIDED,
+    SCHED_RUNTIME,
+    SCHED_ADAPTIVE
+};
+
+#define SCHED_KIND_COUNT 5
+
+// Body for iterations [begin, end)
+typedef void (*sched_body)(long begin, long end, void *ctx);
+
+typedef struct {
+    enum sched_kind kind;
+    long chunk;         // units per chunk; 0 = OpenMP default
+    long grain;         // iterations per unit (default 1)
+    int threads;        // 0 = OpenMP default
+
+    // Adaptive split: part p runs units [bounds[p], bounds[p + 1])
+    long units;         // unit count the split was measured for; 0 = none
+    double *cost;       // seconds per unit from the measuring run
+    long *bounds;       // parts + 1 entries
+    int parts;
+
+    // Last run
+    int used_threads;
+    double *busy;       // seconds per thread
+    long *done;         // units per thread
+    double elapsed;     // wall seconds
+    int capacity;       // entries in busy / done
+} sched_loop;
+
+static inline const char *sched_kind_name(enum sched_kind kind) {
+    switch (kind) {
+    case SCHED_STATIC: return "static";
+    case SCHED_DYNAMIC: return "dynamic";
+    case SCHED_GUIDED: return "guided";
+    case SCHED_RUNTIME: return "runtime";
+    case SCHED_ADAPTIVE: return "adaptive";
+    }
+    return "?";
+}
+
+// "kind" or "kind,chunk"; returns 0 on success
+static inline int sched_parse(const char *spec, enum sched_kind *kind, long *chunk) {
+    const char *comma = strchr(spec, ',');
+    size_t len = comma ? (size_t)(comma - spec) : strlen(spec);
+    for (int k = 0; k < SCHED_KIND_COUNT; k++) {
+        const char *name = sched_kind_name((enum sched_kind)k);
+        if (strlen(name) != len || strncmp(spec, name, len) != 0) continue;
+        long c = 0;
+        if (comma) {
+            char *end;
+            c = strtol(comma + 1, &end, 10);
+            if (*end != '\0' || c < 1) return -1;
+        }
+        *kind = (enum sched_kind)k;
+        *chunk = c;
+        return 0;
+    }
+    return -1;
+}
+
+static inline double sched_now(void) {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+#endif
+}
+
+static inline int sched_max_threads(const sched_loop *loop) {
+#ifdef _OPENMP
+    return loop->threads > 0 ? loop->threads : omp_get_max_threads();
+#else
+    (void)loop;
+    return 1;
+#endif
+}
+
+static inline void sched_loop_reset(sched_loop *loop) {
+    free(loop->cost);
+    free(loop->bounds);
+    loop->cost = NULL;
+    loop->bounds = NULL;
+    loop->units = 0;
+    loop->parts = 0;
+}
+
+// threads = 0 uses the OpenMP default
+static inline void sched_loop_init(sched_loop *loop, enum sched_kind kind, long chunk, int threads) {
+    memset(loop, 0, sizeof(*loop));
+    loop->kind = kind;
+    loop->chunk = chunk;
+    loop->grain = 1;
+    loop->threads = threads;
+}
+
+// Replace kind and chunk with LOOP_SCHEDULE, if set. Programs that compare
+// schedules should not call this.
+static inline void sched_loop_env(sched_loop *loop) {
+    const char *env = getenv("LOOP_SCHEDULE");
+    if (env && sched_parse(env, &loop->kind, &loop->chunk) != 0)
+        fprintf(stderr, "LOOP_SCHEDULE=%s not recognised, using %s\n", env, sched_kind_name(loop->kind));
+}
+
+static inline void sched_loop_free(sched_loop *loop) {
+    sched_loop_reset(loop);
+    free(loop->busy);
+    free(loop->done);
+    loop->busy = NULL;
+    loop->done = NULL;
+    loop->capacity = 0;
+}
+
+// Cut units into parts contiguous ranges of about equal total cost
+static inline void sched_balance(sched_loop *loop, int parts) {
+    free(loop->bounds);
+    loop->bounds = (long *)malloc((size_t)(parts + 1) * sizeof(long));
+    loop->parts = parts;
+    double total = 0;
+    for (long u = 0; u < loop->units; u++) total += loop->cost[u];
+    double prefix = 0;
+    long u = 0;
+    loop->bounds[0] = 0;
+    for (int p = 1; p < parts; p++) {
+        double target = total * p / parts;
+        // Take the next unit while that gets the prefix closer to the target
+        while (u < loop->units && prefix + 0.5 * loop->cost[u] < target) prefix += loop->cost[u++];
+        loop->bounds[p] = u;
+    }
+    loop->bounds[parts] = loop->units;
+}
+
+static inline void sched_run_units(long first, long last, long grain, long n, sched_body body, void *ctx) {
+    long begin = first * grain, end = last * grain;
+    body(begin, end < n ? end : n, ctx);
+}
+
+// Run body over [0, n) with the loop's schedule
+static inline void sched_run(sched_loop *loop, long n, sched_body body, void *ctx) {
+    const long grain = loop->grain > 0 ? loop->grain : 1;
+    const long units = (n + grain - 1) / grain;
+    const int threads = sched_max_threads(loop);
+    if (loop->capacity < threads) {
+        free(loop->busy);
+        free(loop->done);
+        loop->busy = (double *)malloc((size_t)threads * sizeof(double));
+        loop->done = (long *)malloc((size_t)threads * sizeof(long));
+        loop->capacity = threads;
+    }
+    memset(loop->busy, 0, (size_t)threads * sizeof(double));
+    memset(loop->done, 0, (size_t)threads * sizeof(long));
+
+    const int adaptive = loop->kind == SCHED_ADAPTIVE;
+    const int measure = adaptive && loop->units != units;
+    if (measure) {
+        sched_loop_reset(loop);
+        loop->units = units;
+        loop->cost = (double *)calloc((size_t)units, sizeof(double));
+    } else if (adaptive && loop->parts != threads) {
+        sched_balance(loop, threads);
+    }
+
+    // The run-sched ICV is process state: set it for this loop only
+    const int set_schedule = adaptive ? measure : loop->kind != SCHED_RUNTIME;
+#ifdef _OPENMP
+    omp_sched_t saved_kind;
+    int saved_chunk;
+    omp_get_schedule(&saved_kind, &saved_chunk);
+    if (set_schedule) {
+        static const omp_sched_t kinds[] = {omp_sched_static, omp_sched_dynamic, omp_sched_guided};
+        if (adaptive) omp_set_schedule(omp_sched_dynamic, 1);
+        else omp_set_schedule(kinds[loop->kind], (int)loop->chunk);
+    }
+#endif
+
+    double start = sched_now();
+    int used = 1;
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = 0, nt = 1;
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+        nt = omp_get_num_threads();
+#endif
+        double begin = sched_now();
+        long done = 0;
+        if (adaptive && !measure) {
+            // Parts beyond the team size (fewer threads than asked) wrap round
+            for (int p = t; p < loop->parts; p += nt) {
+                long first = loop->bounds[p], last = loop->bounds[p + 1];
+                if (first < last) sched_run_units(first, last, grain, n, body, ctx);
+                done += last - first;
+            }
+        } else {
+            #pragma omp for schedule(runtime) nowait
+            for (long u = 0; u < units; u++) {
+                if (measure) {
+                    double t0 = sched_now();
+                    sched_run_units(u, u + 1, grain, n, body, ctx);
+                    loop->cost[u] = sched_now() - t0;
+                } else {
+                    sched_run_units(u, u + 1, grain, n, body, ctx);
+                }
+                done++;
+            }
+        }
+        loop->busy[t] = sched_now() - begin;
+        loop->done[t] = done;
+        if (t == 0) used = nt;
+    }
+    loop->elapsed = sched_now() - start;
+    loop->used_threads = used;
+#ifdef _OPENMP
+    if (set_schedule) omp_set_schedule(saved_kind, saved_chunk);
+#else
+    (void)set_schedule;
+#endif
+    if (measure) sched_balance(loop, threads);
+}
+
+// Per-thread busy time of the last run; imbalance is max / mean - 1
+static inline void sched_report(const sched_loop *loop, FILE *out) {
+    double max = 0, total = 0;
+    for (int t = 0; t < loop->used_threads; t++) {
+        total += loop->busy[t];
+        if (loop->busy[t] > max) max = loop->busy[t];
+    }
+    double mean = loop->used_threads > 0 ? total / loop->used_threads : 0;
+    fprintf(out, "Schedule %s", sched_kind_name(loop->kind));
+    if (loop->chunk > 0) fprintf(out, ",%ld", loop->chunk);
+    fprintf(out, ": %.3f ms wall, imbalance %.1f%%\n", loop->elapsed * 1e3, mean > 0 ? 100.0 * (max / mean - 1) : 0.0);
+    for (int t = 0; t < loop->used_threads; t++)
+        fprintf(out, "  thread %2d: %9.3f ms busy, %ld units\n", t, loop->busy[t] * 1e3, loop->done[t]);
+}
+
+#ifdef __cplusplus
+
+// sched_run() with any callable taking (long begin, long end)
+template <typename Body>
+void runScheduled(sched_loop& loop, long n, Body body) {
+    sched_run(&loop, n, [](long begin, long end, void* ctx) { (*static_cast<Body*>(ctx))(begin, end); }, &body);
+}
+
+#endif // __cplusplus
+
+#endif
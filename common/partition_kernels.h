@@ -0,0 +1,259 @@
+#ifndef SIT315_PARTITION_KERNELS_H
+#define SIT315_PARTITION_KERNELS_H
+
+// Partition kernels for int keys: move every element below the pivot to the
+// front of the range and return the end of that group. One kernel per
+// instruction set, selected at startup from CPUID like the GEMM kernels, and
+// used by quicksort.h whenever ints are sorted with std::less.
+//
+//   branchless  portable Lomuto loop without a data-dependent branch
+//   avx2        8 lanes, compare + permute through a 256-entry lookup table
+//   avx512      16 lanes, compare + compress-store
+//
+// The SIMD kernels read one vector from whichever end of the unread middle
+// has less room, so every vector can be written back in place: the lanes
+// below the pivot to the left output cursor and the rest to the right one.
+// Each kernel is checked against the branchless one on first use and demoted
+// if they ever disagree.
+//
+// Set SORT_PARTITION=branchless|avx2|avx512 to force a particular kernel.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SORT_X86 1
+#endif
+
+namespace sorting {
+
+enum class PartitionIsa { Branchless = 0, AVX2 = 1, AVX512 = 2 };
+
+inline const char* partitionIsaName(PartitionIsa isa) {
+    switch (isa) {
+    case PartitionIsa::AVX2: return "avx2";
+    case PartitionIsa::AVX512: return "avx512";
+    default: return "branchless";
+    }
+}
+
+// [first, result) < pivot <= [result, last)
+using PartitionKernel = int* (*)(int* first, int* last, int pivot);
+
+namespace detail {
+
+inline int* partitionBranchless(int* first, int* last, int pivot) {
+    int* store = first;
+    for (int* p = first; p < last; ++p) {
+        int value = *p;
+        *p = *store;
+        *store = value;
+        store += value < pivot;
+    }
+    return store;
+}
+
+// Write count buffered values into the gap [lo, hi), which fits them exactly
+inline int* partitionFromBuffer(const int* buf, int count, int* lo, int* hi, int pivot) {
+    for (int i = 0; i < count; i++) {
+        int value = buf[i];
+        bool less = value < pivot;
+        *(less ? lo : hi - 1) = value;
+        lo += less;
+        hi -= !less;
+    }
+    return lo;
+}
+
+#ifdef SORT_X86
+
+// For each 8-bit mask, the lanes whose bit is set followed by the others
+struct CompressTable {
+    alignas(64) uint8_t lanes[256][8];
+
+    CompressTable() {
+        for (int mask = 0; mask < 256; mask++) {
+            int k = 0;
+            for (int lane = 0; lane < 8; lane++)
+                if (mask >> lane & 1) lanes[mask][k++] = uint8_t(lane);
+            for (int lane = 0; lane < 8; lane++)
+                if (!(mask >> lane & 1)) lanes[mask][k++] = uint8_t(lane);
+        }
+    }
+
+    static const CompressTable& instance() {
+        static const CompressTable table;
+        return table;
+    }
+};
+
+__attribute__((target("avx2")))
+inline int* partitionAVX2(int* first, int* last, int pivot) {
+    const int W = 8;
+    if (last - first < 2 * W) return partitionBranchless(first, last, pivot);
+    const CompressTable& table = CompressTable::instance();
+    const __m256i p = _mm256_set1_epi32(pivot);
+    const __m256i keepLeft = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+    const __m256i keepRight = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last - W));
+    int* l = first + W;         // unread middle is [l, r)
+    int* r = last - W;
+    int* lStore = first;        // output is [first, lStore) and [rStore, last)
+    int* rStore = last;
+    while (r - l >= W) {
+        __m256i v;
+        if (l - lStore <= rStore - r) {
+            v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(l));
+            l += W;
+        } else {
+            r -= W;
+            v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r));
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(p, v)));
+        int nLess = __builtin_popcount(mask);
+        __m128i idx = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(table.lanes[mask]));
+        __m256i packed = _mm256_permutevar8x32_epi32(v, _mm256_cvtepu8_epi32(idx));
+        // Both sides have at least W free slots, so the lanes beyond each
+        // group only land on space that is rewritten later
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lStore), packed);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rStore - W), packed);
+        lStore += nLess;
+        rStore -= W - nLess;
+    }
+    alignas(32) int buf[3 * W];
+    int count = int(r - l);
+    std::copy(l, r, buf);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf + count), keepLeft);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf + count + W), keepRight);
+    return partitionFromBuffer(buf, count + 2 * W, lStore, rStore, pivot);
+}
+
+__attribute__((target("avx512f")))
+inline int* partitionAVX512(int* first, int* last, int pivot) {
+    const int W = 16;
+    if (last - first < 2 * W) return partitionBranchless(first, last, pivot);
+    const __m512i p = _mm512_set1_epi32(pivot);
+    const __m512i keepLeft = _mm512_loadu_si512(first);
+    const __m512i keepRight = _mm512_loadu_si512(last - W);
+    int* l = first + W;
+    int* r = last - W;
+    int* lStore = first;
+    int* rStore = last;
+    while (r - l >= W) {
+        __m512i v;
+        if (l - lStore <= rStore - r) {
+            v = _mm512_loadu_si512(l);
+            l += W;
+        } else {
+            r -= W;
+            v = _mm512_loadu_si512(r);
+        }
+        __mmask16 less = _mm512_cmplt_epi32_mask(v, p);
+        int nLess = __builtin_popcount(less);
+        _mm512_mask_compressstoreu_epi32(lStore, less, v);
+        lStore += nLess;
+        rStore -= W - nLess;
+        _mm512_mask_compressstoreu_epi32(rStore, __mmask16(~less), v);
+    }
+    alignas(64) int buf[3 * W];
+    int count = int(r - l);
+    std::copy(l, r, buf);
+    _mm512_storeu_si512(buf + count, keepLeft);
+    _mm512_storeu_si512(buf + count + W, keepRight);
+    return partitionFromBuffer(buf, count + 2 * W, lStore, rStore, pivot);
+}
+
+#endif // SORT_X86
+
+inline PartitionKernel partitionKernelFor(PartitionIsa isa) {
+#ifdef SORT_X86
+    switch (isa) {
+    case PartitionIsa::AVX2: return partitionAVX2;
+    case PartitionIsa::AVX512: return partitionAVX512;
+    default: break;
+    }
+#endif
+    (void)isa;
+    return partitionBranchless;
+}
+
+inline PartitionIsa cpuPartitionIsa() {
+#ifdef SORT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return PartitionIsa::AVX512;
+    if (__builtin_cpu_supports("avx2")) return PartitionIsa::AVX2;
+#endif
+    return PartitionIsa::Branchless;
+}
+
+inline PartitionIsa requestedPartitionIsa() {
+    PartitionIsa best = cpuPartitionIsa();
+    const char* env = std::getenv("SORT_PARTITION");
+    if (!env) return best;
+    PartitionIsa want = best;
+    if (!std::strcmp(env, "branchless")) want = PartitionIsa::Branchless;
+    else if (!std::strcmp(env, "avx2")) want = PartitionIsa::AVX2;
+    else if (!std::strcmp(env, "avx512")) want = PartitionIsa::AVX512;
+    else std::fprintf(stderr, "SORT_PARTITION=%s not recognised, using %s\n", env, partitionIsaName(best));
+    if (want > best) {
+        std::fprintf(stderr, "SORT_PARTITION=%s not supported by this CPU, using %s\n", env, partitionIsaName(best));
+        want = best;
+    }
+    return want;
+}
+
+} // namespace detail
+
+// Partition pseudo-random data of many lengths (including the short and
+// remainder paths) with the ISA kernel and require the same split point, a
+// valid split and the same multiset of values as the branchless kernel.
+inline bool verifyPartitionKernel(PartitionIsa isa) {
+    PartitionKernel test = detail::partitionKernelFor(isa);
+    unsigned seed = 12345;
+    auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return int(seed >> 16) % 101 - 50; };
+    for (int n = 0; n <= 300; n += (n < 70 ? 1 : 23)) {
+        std::vector<int> a(n);
+        for (auto& v : a) v = next();
+        std::vector<int> b = a;
+        int pivot = n ? a[n / 2] : 0;
+        int* splitA = test(a.data(), a.data() + n, pivot);
+        int* splitB = detail::partitionBranchless(b.data(), b.data() + n, pivot);
+        if (splitA - a.data() != splitB - b.data()) return false;
+        for (int* q = a.data(); q < a.data() + n; q++)
+            if ((*q < pivot) != (q < splitA)) return false;
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        if (a != b) return false;
+    }
+    return true;
+}
+
+struct PartitionDispatch {
+    PartitionIsa isa;
+    PartitionKernel kernel;
+
+    PartitionDispatch() {
+        isa = detail::requestedPartitionIsa();
+        while (isa != PartitionIsa::Branchless && !verifyPartitionKernel(isa)) {
+            std::fprintf(stderr, "Partition %s kernel failed self-check, falling back\n", partitionIsaName(isa));
+            isa = PartitionIsa(int(isa) - 1);
+        }
+        kernel = detail::partitionKernelFor(isa);
+    }
+
+    static const PartitionDispatch& instance() {
+        static const PartitionDispatch d;
+        return d;
+    }
+};
+
+inline PartitionKernel partitionKernel() { return PartitionDispatch::instance().kernel; }
+inline PartitionIsa selectedPartitionIsa() { return PartitionDispatch::instance().isa; }
+
+} // namespace sorting
+
+#endif
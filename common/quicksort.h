@@ -0,0 +1,289 @@
+#ifndef SIT315_QUICKSORT_H
+#define SIT315_QUICKSORT_H
+
+// Quicksort building blocks shared by the sorting programs: a serial
+// introsort (quicksort on a median-of-three or ninther pivot, heapsort once
+// the recursion gets too deep, insertion sort for short ranges) and a
+// task-parallel quicksort that opens one OpenMP parallel region and spawns a
+// task per partition until the ranges fall below a cutoff, then finishes them
+// with the serial introsort. Ranges large enough to keep every thread busy
+// are partitioned in parallel as well, so the top levels are not serial.
+// Ints sorted with std::less partition through the branchless / SIMD kernels
+// of partition_kernels.h; other types use a Hoare partition.
+// Compile with -fopenmp for the parallel version to use more than one thread.
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "partition_kernels.h"
+
+namespace sorting {
+
+// Ranges this short are insertion sorted
+const std::ptrdiff_t INSERTION_THRESHOLD = 16;
+
+// Ranges this short are sorted serially by the task that reaches them
+const std::ptrdiff_t DEFAULT_TASK_CUTOFF = std::ptrdiff_t(1) << 15;
+
+// Ranges at least this long take the pivot from Tukey's ninther
+const std::ptrdiff_t NINTHER_THRESHOLD = 128;
+
+// Ranges at least this long are partitioned by all threads, in chunks of at
+// least PARALLEL_PARTITION_CHUNK elements
+const std::ptrdiff_t PARALLEL_PARTITION_THRESHOLD = std::ptrdiff_t(1) << 18;
+const std::ptrdiff_t PARALLEL_PARTITION_CHUNK = std::ptrdiff_t(1) << 16;
+
+template <typename T, typename Compare>
+void insertionSort(T* first, T* last, Compare comp) {
+    for (T* i = first + 1; i < last; ++i) {
+        T value = std::move(*i);
+        T* j = i;
+        for (; j > first && comp(value, *(j - 1)); --j) *j = std::move(*(j - 1));
+        *j = std::move(value);
+    }
+}
+
+template <typename T, typename Compare>
+void heapSort(T* first, T* last, Compare comp) {
+    std::make_heap(first, last, comp);
+    std::sort_heap(first, last, comp);
+}
+
+template <typename T, typename Compare>
+T* median3(T* a, T* b, T* c, Compare comp) {
+    if (comp(*a, *b)) return comp(*b, *c) ? b : (comp(*a, *c) ? c : a);
+    return comp(*a, *c) ? a : (comp(*b, *c) ? c : b);
+}
+
+// Median of three for short ranges, Tukey's ninther (median of three
+// medians of three) for long ones, so sorted, reversed and organ-pipe inputs
+// still split near the middle. Samples never include *first, which keeps an
+// element >= pivot right of it for the unguarded scans in partition().
+template <typename T, typename Compare>
+T* choosePivot(T* first, T* last, Compare comp) {
+    const std::ptrdiff_t n = last - first;
+    T* mid = first + n / 2;
+    if (n < NINTHER_THRESHOLD) return median3(first + 1, mid, last - 1, comp);
+    const std::ptrdiff_t step = n / 8;
+    return median3(median3(first + 1, first + 1 + step, first + 1 + 2 * step, comp),
+                   median3(mid - step, mid, mid + step, comp),
+                   median3(last - 1 - 2 * step, last - 1 - step, last - 1, comp), comp);
+}
+
+// Hoare partition of [first, last) (at least 3 elements) around the chosen
+// pivot. Returns cut such that [first, cut) <= pivot <= [cut, last); keys
+// equal to the pivot end up on both sides, so duplicates split evenly.
+template <typename T, typename Compare>
+T* partition(T* first, T* last, Compare comp) {
+    std::iter_swap(first, choosePivot(first, last, comp));
+    T* lo = first + 1;
+    T* hi = last;
+    while (true) {
+        while (comp(*lo, *first)) ++lo;
+        --hi;
+        while (comp(*first, *hi)) --hi;
+        if (!(lo < hi)) return lo;
+        std::iter_swap(lo, hi);
+        ++lo;
+    }
+}
+
+// Move the elements below pivot to the front of [first, last) and return
+// the end of that group
+template <typename T, typename Compare>
+T* partitionLess(T* first, T* last, const T& pivot, Compare comp) {
+    return std::partition(first, last, [&](const T& x) { return comp(x, pivot); });
+}
+
+inline int* partitionLess(int* first, int* last, const int& pivot, std::less<int>) {
+    return partitionKernel()(first, last, pivot);
+}
+
+// Same for the elements not above pivot
+template <typename T, typename Compare>
+T* partitionNotGreater(T* first, T* last, const T& pivot, Compare comp) {
+    return std::partition(first, last, [&](const T& x) { return !comp(pivot, x); });
+}
+
+inline int* partitionNotGreater(int* first, int* last, const int& pivot, std::less<int>) {
+    return pivot == INT_MAX ? last : partitionKernel()(first, last, pivot + 1);
+}
+
+// One quicksort step: returns {leftEnd, rightBegin} with [first, leftEnd) <=
+// pivot <= [rightBegin, last); anything in between is already in place.
+template <typename T, typename Compare>
+std::pair<T*, T*> partitionStep(T* first, T* last, Compare comp) {
+    T* cut = partition(first, last, comp);
+    return {cut, cut};
+}
+
+// Int version on the partition kernel. The pivot is set aside so it lands in
+// its final slot, and when few keys fall below it the keys equal to it are
+// split off too, so runs of duplicates cannot stall the recursion.
+inline std::pair<int*, int*> partitionStep(int* first, int* last, std::less<int> comp) {
+    std::iter_swap(first, choosePivot(first, last, comp));
+    const int pivot = *first;
+    int* mid = partitionLess(first + 1, last, pivot, comp);
+    std::iter_swap(first, mid - 1);
+    int* rightBegin = mid;
+    if (mid - 1 - first < (last - first) / 16) rightBegin = partitionNotGreater(mid, last, pivot, comp);
+    return {mid - 1, rightBegin};
+}
+
+// Disjoint spans of misplaced elements, indexed as one sequence
+template <typename T>
+struct MisplacedSpans {
+    std::vector<T*> begin;
+    std::vector<std::ptrdiff_t> start;
+    std::ptrdiff_t total = 0;
+
+    void add(T* b, T* e) {
+        if (b < e) {
+            begin.push_back(b);
+            start.push_back(total);
+            total += e - b;
+        }
+    }
+
+    size_t find(std::ptrdiff_t k) const {
+        return size_t(std::upper_bound(start.begin(), start.end(), k) - start.begin()) - 1;
+    }
+
+    std::ptrdiff_t length(size_t span) const {
+        return (span + 1 < start.size() ? start[span + 1] : total) - start[span];
+    }
+};
+
+// In-place parallel partition: each of `chunks` tasks partitions its own
+// block serially with part(begin, end), which returns the end of the block's
+// left group, then the elements on the wrong side of the global split point
+// are swapped pairwise, again split evenly across tasks. Returns the global
+// split point. Must be called from inside an OpenMP parallel region.
+template <typename T, typename ChunkPartition>
+T* parallelPartition(T* first, T* last, ChunkPartition part, int chunks) {
+    const std::ptrdiff_t n = last - first;
+    std::vector<T*> bounds(chunks + 1);
+    std::vector<T*> splits(chunks);
+    for (int c = 0; c <= chunks; c++) bounds[c] = first + n * c / chunks;
+
+    #pragma omp taskloop grainsize(1) shared(bounds, splits, part)
+    for (int c = 0; c < chunks; c++) splits[c] = part(bounds[c], bounds[c + 1]);
+
+    T* mid = first;
+    for (int c = 0; c < chunks; c++) mid += splits[c] - bounds[c];
+
+    // Right-side elements left of mid and left-side elements right of mid
+    MisplacedSpans<T> wrongLeft, wrongRight;
+    for (int c = 0; c < chunks; c++) {
+        wrongLeft.add(std::max(splits[c], first), std::min(bounds[c + 1], mid));
+        wrongRight.add(std::max(bounds[c], mid), std::min(splits[c], last));
+    }
+
+    const std::ptrdiff_t total = wrongLeft.total;
+    #pragma omp taskloop grainsize(1) shared(wrongLeft, wrongRight)
+    for (int c = 0; c < chunks; c++) {
+        std::ptrdiff_t k = total * c / chunks, end = total * (c + 1) / chunks;
+        if (k == end) continue;
+        size_t a = wrongLeft.find(k), b = wrongRight.find(k);
+        while (k < end) {
+            std::ptrdiff_t ia = k - wrongLeft.start[a], ib = k - wrongRight.start[b];
+            std::ptrdiff_t run = std::min(std::min(wrongLeft.length(a) - ia, wrongRight.length(b) - ib), end - k);
+            std::swap_ranges(wrongLeft.begin[a] + ia, wrongLeft.begin[a] + ia + run, wrongRight.begin[b] + ib);
+            k += run;
+            if (ia + run == wrongLeft.length(a)) a++;
+            if (ib + run == wrongRight.length(b)) b++;
+        }
+    }
+    return mid;
+}
+
+template <typename T, typename Compare>
+void introsortLoop(T* first, T* last, int depthLimit, Compare comp) {
+    while (last - first > INSERTION_THRESHOLD) {
+        if (depthLimit == 0) {
+            heapSort(first, last, comp);
+            return;
+        }
+        --depthLimit;
+        std::pair<T*, T*> cut = partitionStep(first, last, comp);
+        introsortLoop(cut.second, last, depthLimit, comp);
+        last = cut.first;
+    }
+    insertionSort(first, last, comp);
+}
+
+// 2 * floor(log2(n)), the usual introsort recursion budget
+inline int depthLimitFor(std::ptrdiff_t n) {
+    int depth = 0;
+    for (; n > 1; n >>= 1) depth += 2;
+    return depth;
+}
+
+template <typename T, typename Compare = std::less<T>>
+void introsort(T* first, T* last, Compare comp = Compare()) {
+    if (last - first < 2) return;
+    introsortLoop(first, last, depthLimitFor(last - first), comp);
+}
+
+template <typename T, typename Compare>
+void quicksortTask(T* first, T* last, std::ptrdiff_t cutoff, int depthLimit, int numThreads, Compare comp) {
+    const std::ptrdiff_t n = last - first;
+    if (n <= cutoff || depthLimit == 0) {
+        introsortLoop(first, last, depthLimit, comp);
+        return;
+    }
+    T* cut;
+    T* rightBegin;
+    const int chunks = int(std::min<std::ptrdiff_t>(numThreads, n / PARALLEL_PARTITION_CHUNK));
+    if (n >= PARALLEL_PARTITION_THRESHOLD && chunks > 1) {
+        const T pivot = *choosePivot(first, last, comp);
+        cut = parallelPartition(first, last, [&](T* b, T* e) { return partitionLess(b, e, pivot, comp); }, chunks);
+        rightBegin = cut;
+        // Few keys below the pivot usually means many equal to it: split
+        // those off as well, which also guarantees progress
+        if (cut - first < n / 16)
+            rightBegin = parallelPartition(cut, last, [&](T* b, T* e) { return partitionNotGreater(b, e, pivot, comp); },
+                                           chunks);
+    } else {
+        std::tie(cut, rightBegin) = partitionStep(first, last, comp);
+    }
+    #pragma omp task firstprivate(first, cut, cutoff, depthLimit, numThreads, comp)
+    quicksortTask(first, cut, cutoff, depthLimit - 1, numThreads, comp);
+    quicksortTask(rightBegin, last, cutoff, depthLimit - 1, numThreads, comp);
+    #pragma omp taskwait
+}
+
+// Sort [first, last) with up to numThreads threads (0 = OpenMP default).
+// Only one parallel region is created however deep the recursion goes.
+template <typename T, typename Compare = std::less<T>>
+void parallelQuicksort(T* first, T* last, int numThreads = 0,
+                       std::ptrdiff_t cutoff = DEFAULT_TASK_CUTOFF, Compare comp = Compare()) {
+    const std::ptrdiff_t n = last - first;
+    if (n < 2) return;
+    cutoff = std::max(cutoff, INSERTION_THRESHOLD);
+    const int depthLimit = depthLimitFor(n);
+#ifdef _OPENMP
+    if (numThreads <= 0) numThreads = omp_get_max_threads();
+    if (numThreads > 1 && n > cutoff) {
+        #pragma omp parallel num_threads(numThreads)
+        #pragma omp single nowait
+        quicksortTask(first, last, cutoff, depthLimit, numThreads, comp);
+        return;
+    }
+#endif
+    (void)numThreads;
+    introsortLoop(first, last, depthLimit, comp);
+}
+
+} // namespace sorting
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef SIT315_RADIX_SORT_H
+#define SIT315_RADIX_SORT_H
+
+// Parallel LSD radix sort for 32/64-bit integer keys, optionally carrying a
+// value per key. Each pass sorts on one digit of the key's offset from the
+// minimum key, so bounded keys (e.g. rand() % 1000000) need only as many
+// digits as their range has bits; digits are up to RADIX_MAX_BITS wide.
+//
+// Per pass every thread histograms its own contiguous chunk, one prefix sum
+// over (digit, thread) gives each thread its output offsets, and the threads
+// scatter through per-digit cache-line write-combining buffers so the writes
+// leave in full lines instead of one element at a time. The sort is stable.
+// Compile with -fopenmp for the passes to run in parallel.
+//
+// chooseSortAlgorithm() picks between this and the quicksort in quicksort.h
+// from the input size and key range.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "quicksort.h"
+
+namespace sorting {
+
+const int RADIX_MAX_BITS = 11;
+
+// Below this size auto selection always uses quicksort
+const std::ptrdiff_t RADIX_MIN_SIZE = std::ptrdiff_t(1) << 14;
+
+// Order-preserving map from the key type to an unsigned integer
+template <typename K> struct RadixKey;
+template <> struct RadixKey<int32_t> {
+    using U = uint32_t;
+    static U map(int32_t k) { return U(k) ^ 0x80000000u; }
+};
+template <> struct RadixKey<uint32_t> {
+    using U = uint32_t;
+    static U map(uint32_t k) { return k; }
+};
+template <> struct RadixKey<int64_t> {
+    using U = uint64_t;
+    static U map(int64_t k) { return U(k) ^ 0x8000000000000000ull; }
+};
+template <> struct RadixKey<uint64_t> {
+    using U = uint64_t;
+    static U map(uint64_t k) { return k; }
+};
+
+// Digit layout for one input: passes of digitBits over (key - minKey)
+template <typename K>
+struct RadixPlan {
+    typename RadixKey<K>::U minKey = 0;
+    int bits = 0;
+    int passes = 0;
+    int digitBits = 0;
+};
+
+inline int radixThreads(int numThreads) {
+#ifdef _OPENMP
+    return numThreads > 0 ? numThreads : omp_get_max_threads();
+#else
+    (void)numThreads;
+    return 1;
+#endif
+}
+
+template <typename K>
+RadixPlan<K> planRadix(const K* first, const K* last, int numThreads = 0) {
+    using U = typename RadixKey<K>::U;
+    const std::ptrdiff_t n = last - first;
+    RadixPlan<K> plan;
+    if (n < 2) return plan;
+    U lo = RadixKey<K>::map(first[0]), hi = lo;
+    const int threads = radixThreads(numThreads);
+    #pragma omp parallel for num_threads(threads) reduction(min : lo) reduction(max : hi) schedule(static)
+    for (std::ptrdiff_t i = 0; i < n; i++) {
+        U k = RadixKey<K>::map(first[i]);
+        lo = std::min(lo, k);
+        hi = std::max(hi, k);
+    }
+    U range = hi - lo;
+    while (range) {
+        plan.bits++;
+        range >>= 1;
+    }
+    plan.minKey = lo;
+    plan.passes = (plan.bits + RADIX_MAX_BITS - 1) / RADIX_MAX_BITS;
+    plan.digitBits = plan.passes ? (plan.bits + plan.passes - 1) / plan.passes : 0;
+    return plan;
+}
+
+namespace detail {
+
+// Placeholder value type for key-only sorts
+struct NoValue {};
+
+template <typename K, typename V, bool HasValues>
+void radixSortImpl(K* keys, V* values, std::ptrdiff_t n, const RadixPlan<K>& plan, int numThreads) {
+    using U = typename RadixKey<K>::U;
+    if (plan.passes == 0) return;
+    const int threads = radixThreads(numThreads);
+    const size_t buckets = size_t(1) << plan.digitBits;
+    const U mask = U(buckets - 1);
+    const U minKey = plan.minKey;
+    // Elements per write-combining line
+    const int lineKeys = int(64 / sizeof(K));
+
+    std::vector<K> keyScratch(n);
+    std::vector<V> valueScratch(HasValues ? n : 0);
+    std::vector<size_t> offsets(size_t(threads) * buckets);
+    std::vector<char> skip(plan.passes, 0);
+
+    #pragma omp parallel num_threads(threads)
+    {
+#ifdef _OPENMP
+        const int t = omp_get_thread_num(), team = omp_get_num_threads();
+#else
+        const int t = 0, team = 1;
+#endif
+        const std::ptrdiff_t begin = n * t / team, end = n * (t + 1) / team;
+        size_t* offset = offsets.data() + size_t(t) * buckets;
+        std::vector<K> keyLines(buckets * lineKeys);
+        std::vector<V> valueLines(HasValues ? buckets * lineKeys : 0);
+        std::vector<int> fill(buckets);
+
+        K* srcKeys = keys;
+        K* dstKeys = keyScratch.data();
+        V* srcValues = values;
+        V* dstValues = valueScratch.data();
+
+        for (int pass = 0; pass < plan.passes; pass++) {
+            const int shift = pass * plan.digitBits;
+
+            std::fill(offset, offset + buckets, size_t(0));
+            for (std::ptrdiff_t i = begin; i < end; i++)
+                offset[((RadixKey<K>::map(srcKeys[i]) - minKey) >> shift) & mask]++;
+            #pragma omp barrier
+
+            // Exclusive prefix sum in (digit, thread) order keeps the sort
+            // stable; a pass where every key has the same digit is skipped
+            #pragma omp single
+            {
+                size_t sum = 0;
+                for (size_t d = 0; d < buckets; d++) {
+                    size_t digitTotal = 0;
+                    for (int u = 0; u < team; u++) {
+                        size_t& slot = offsets[size_t(u) * buckets + d];
+                        size_t count = slot;
+                        slot = sum;
+                        sum += count;
+                        digitTotal += count;
+                    }
+                    if (digitTotal == size_t(n)) skip[pass] = 1;
+                }
+            }
+            if (skip[pass]) continue;
+
+            std::fill(fill.begin(), fill.end(), 0);
+            for (std::ptrdiff_t i = begin; i < end; i++) {
+                const K key = srcKeys[i];
+                const size_t d = ((RadixKey<K>::map(key) - minKey) >> shift) & mask;
+                const size_t slot = d * lineKeys + fill[d];
+                keyLines[slot] = key;
+                if (HasValues) valueLines[slot] = srcValues[i];
+                if (++fill[d] == lineKeys) {
+                    std::memcpy(dstKeys + offset[d], &keyLines[d * lineKeys], lineKeys * sizeof(K));
+                    if (HasValues)
+                        std::copy(&valueLines[d * lineKeys], &valueLines[d * lineKeys] + lineKeys,
+                                  dstValues + offset[d]);
+                    offset[d] += lineKeys;
+                    fill[d] = 0;
+                }
+            }
+            for (size_t d = 0; d < buckets; d++) {
+                if (fill[d] == 0) continue;
+                std::memcpy(dstKeys + offset[d], &keyLines[d * lineKeys], fill[d] * sizeof(K));
+                if (HasValues)
+                    std::copy(&valueLines[d * lineKeys], &valueLines[d * lineKeys] + fill[d], dstValues + offset[d]);
+            }
+            #pragma omp barrier
+
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcValues, dstValues);
+        }
+
+        // An odd number of scatters leaves the result in the scratch buffers
+        if (srcKeys != keys) {
+            std::copy(srcKeys + begin, srcKeys + end, keys + begin);
+            if (HasValues) std::copy(srcValues + begin, srcValues + end, values + begin);
+        }
+    }
+}
+
+} // namespace detail
+
+template <typename K>
+void radixSort(K* first, K* last, int numThreads = 0) {
+    const RadixPlan<K> plan = planRadix(first, last, numThreads);
+    detail::radixSortImpl<K, detail::NoValue, false>(first, nullptr, last - first, plan, numThreads);
+}
+
+// Sort keys and permute values with them (stable on equal keys)
+template <typename K, typename V>
+void radixSortPairs(K* keys, K* keysEnd, V* values, int numThreads = 0) {
+    const RadixPlan<K> plan = planRadix(keys, keysEnd, numThreads);
+    detail::radixSortImpl<K, V, true>(keys, values, keysEnd - keys, plan, numThreads);
+}
+
+enum class SortAlgorithm { Quicksort, Radix };
+
+inline const char* sortAlgorithmName(SortAlgorithm algorithm) {
+    return algorithm == SortAlgorithm::Radix ? "radix" : "quicksort";
+}
+
+// Radix sort costs one histogram read and one scattered write of the data per
+// digit; quicksort one partition pass per level, about log2(n) passes. A
+// radix pass measures at roughly two partition passes, so radix is picked
+// once 2 * passes <= log2(n): from 2^14 keys for ints in a 2^20 range, and
+// also for full-range 64-bit keys (6 passes) at that size.
+template <typename K>
+SortAlgorithm chooseSortAlgorithm(const K* first, const K* last, int numThreads = 0) {
+    const std::ptrdiff_t n = last - first;
+    if (n < RADIX_MIN_SIZE) return SortAlgorithm::Quicksort;
+    const RadixPlan<K> plan = planRadix(first, last, numThreads);
+    return 2 * plan.passes <= depthLimitFor(n) / 2 ? SortAlgorithm::Radix : SortAlgorithm::Quicksort;
+}
+
+} // namespace sorting
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef SIT315_REDUCE_H
+#define SIT315_REDUCE_H
+
+// Parallel sums with pluggable strategies, to compare them and to pick the
+// fastest one that is accurate enough for each data type.
+//
+//   atomic    #pragma omp atomic on one shared total for every element; all
+//             threads serialise on a single cache line (baseline only)
+//   critical  per-thread partial sums, combined in a critical section
+//   clause    the OpenMP reduction(+) clause
+//   padded    per-thread partials in separate cache lines, combined by the
+//             calling thread in thread order (deterministic)
+//   simd      reduction clause plus `omp simd`: each thread keeps one partial
+//             per vector lane and adds them horizontally at the end
+//   pairwise  per-thread pairwise (cascade) summation; rounding error grows
+//             with log n instead of n
+//   kahan     per-thread Kahan sums (each step's rounding error is fed
+//             back into the next addend), combined with Neumaier's variant;
+//             error stays near a few ulps until n * epsilon^2 matters
+//
+// Integers are summed exactly into a 64-bit accumulator by every strategy,
+// so pairwise and kahan, which only change rounding, have nothing to offer
+// there (kahan runs the padded loop); appliesTo() leaves them out.
+// Floating-point values are accumulated in their own precision, so the
+// strategies differ in accuracy as well as speed. The compensated loops
+// rely on strict IEEE evaluation: do not build them with -ffast-math.
+//
+// With <mpi.h> included first, allreduce() adds a tier across ranks: the
+// local strategy, then MPI_Allreduce. For pairwise and kahan it gathers the
+// per-rank partials and combines them the same way on every rank instead.
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace reduce {
+
+enum class Strategy { Atomic, Critical, Clause, Padded, Simd, Pairwise, Kahan };
+
+const Strategy ALL_STRATEGIES[] = {Strategy::Atomic, Strategy::Critical, Strategy::Clause, Strategy::Padded,
+                                   Strategy::Simd,   Strategy::Pairwise, Strategy::Kahan};
+
+inline const char* strategyName(Strategy s) {
+    switch (s) {
+    case Strategy::Atomic: return "atomic";
+    case Strategy::Critical: return "critical";
+    case Strategy::Clause: return "clause";
+    case Strategy::Padded: return "padded";
+    case Strategy::Simd: return "simd";
+    case Strategy::Pairwise: return "pairwise";
+    case Strategy::Kahan: return "kahan";
+    }
+    return "?";
+}
+
+inline bool parseStrategy(const char* name, Strategy& s) {
+    for (Strategy candidate : ALL_STRATEGIES) {
+        if (std::strcmp(name, strategyName(candidate)) == 0) {
+            s = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Accumulator type: 64-bit for integers, the value type itself otherwise
+template <typename T, bool Integral = std::is_integral<T>::value> struct SumType { typedef T type; };
+template <typename T> struct SumType<T, true> {
+    typedef typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type type;
+};
+
+// Whether strategy s is worth comparing for element type T
+template <typename T>
+bool appliesTo(Strategy s) {
+    return !std::is_integral<T>::value || (s != Strategy::Pairwise && s != Strategy::Kahan);
+}
+
+// Below this many elements pairwise summation adds serially (vectorised)
+const size_t PAIRWISE_BLOCK = 128;
+
+template <typename A>
+struct alignas(64) PaddedSlot {
+    A sum = 0;
+    A compensation = 0;
+};
+
+namespace detail {
+
+inline int threadIndex() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+inline int threadCount() {
+#ifdef _OPENMP
+    return omp_get_num_threads();
+#else
+    return 1;
+#endif
+}
+
+inline int maxThreads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+template <typename A, typename T>
+A pairwise(const T* x, size_t n) {
+    if (n <= PAIRWISE_BLOCK) {
+        A total = 0;
+        #pragma omp simd reduction(+:total)
+        for (size_t i = 0; i < n; i++) total += A(x[i]);
+        return total;
+    }
+    size_t half = n / 2;
+    return pairwise<A>(x, half) + pairwise<A>(x + half, n - half);
+}
+
+// Classic Kahan step: the correction is subtracted from the next addend, so
+// it never accumulates on its own (a separately summed Neumaier compensation
+// drifts once n * epsilon is not small, e.g. 1e7 floats)
+template <typename A>
+void kahanAdd(A& sum, A& correction, A x) {
+    A y = x - correction;
+    A t = sum + y;
+    correction = (t - sum) - y;
+    sum = t;
+}
+
+// Neumaier's variant of Kahan summation: also exact when the addend is
+// larger than the running sum; used to combine a few partial sums
+template <typename A>
+void compensatedAdd(A& sum, A& compensation, A x) {
+    A t = sum + x;
+    if (std::fabs(sum) >= std::fabs(x)) compensation += (sum - t) + x;
+    else compensation += (x - t) + sum;
+    sum = t;
+}
+
+// Sum of one thread's slice into its slot
+template <typename A, typename T>
+void slotSum(Strategy s, const T* x, size_t n, PaddedSlot<A>& slot) {
+    if (s == Strategy::Pairwise) {
+        slot.sum = pairwise<A>(x, n);
+    } else if (s == Strategy::Kahan && !std::is_integral<A>::value) {
+        A sum = 0, correction = 0;
+        for (size_t i = 0; i < n; i++) kahanAdd(sum, correction, A(x[i]));
+        slot.sum = sum;
+        slot.compensation = -correction;
+    } else {
+        A sum = 0;
+        for (size_t i = 0; i < n; i++) sum += A(x[i]);
+        slot.sum = sum;
+    }
+}
+
+// Combine per-thread (or per-rank) slots in order
+template <typename A>
+A combine(Strategy s, const PaddedSlot<A>* slots, size_t count) {
+    if (s == Strategy::Kahan && !std::is_integral<A>::value) {
+        A sum = 0, compensation = 0;
+        for (size_t k = 0; k < count; k++) {
+            compensatedAdd(sum, compensation, slots[k].sum);
+            compensation += slots[k].compensation;
+        }
+        return sum + compensation;
+    }
+    A total = 0;
+    for (size_t k = 0; k < count; k++) total += slots[k].sum;
+    return total;
+}
+
+// Per-thread slots over static slices; the slot-based strategies
+template <typename A, typename T>
+std::vector<PaddedSlot<A>> slotSums(const T* x, size_t n, Strategy s, int threads) {
+    std::vector<PaddedSlot<A>> slots(threads);
+    #pragma omp parallel num_threads(threads)
+    {
+        size_t t = size_t(threadIndex()), nt = size_t(threadCount());
+        size_t begin = n * t / nt, end = n * (t + 1) / nt;
+        slotSum(s, x + begin, end - begin, slots[t]);
+    }
+    return slots;
+}
+
+} // namespace detail
+
+// Sum of x[0 .. n) with strategy s on up to `threads` threads (0 = OpenMP
+// default)
+template <typename T>
+typename SumType<T>::type sum(const T* x, size_t n, Strategy s, int threads = 0) {
+    typedef typename SumType<T>::type A;
+    if (threads <= 0) threads = detail::maxThreads();
+    const long long len = (long long)n;
+    A total = 0;
+    switch (s) {
+    case Strategy::Atomic:
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        for (long long i = 0; i < len; i++) {
+            A v = A(x[i]);
+            #pragma omp atomic
+            total += v;
+        }
+        return total;
+    case Strategy::Critical:
+        #pragma omp parallel num_threads(threads)
+        {
+            A local = 0;
+            #pragma omp for schedule(static)
+            for (long long i = 0; i < len; i++) local += A(x[i]);
+            #pragma omp critical
+            total += local;
+        }
+        return total;
+    case Strategy::Clause:
+        #pragma omp parallel for num_threads(threads) schedule(static) reduction(+:total)
+        for (long long i = 0; i < len; i++) total += A(x[i]);
+        return total;
+    case Strategy::Simd:
+        #pragma omp parallel for simd num_threads(threads) schedule(static) reduction(+:total)
+        for (long long i = 0; i < len; i++) total += A(x[i]);
+        return total;
+    case Strategy::Padded:
+    case Strategy::Pairwise:
+    case Strategy::Kahan: {
+        std::vector<PaddedSlot<A>> slots = detail::slotSums<A>(x, n, s, threads);
+        return detail::combine(s, slots.data(), slots.size());
+    }
+    }
+    return total;
+}
+
+#ifdef MPI_VERSION
+template <typename A> MPI_Datatype mpiType();
+template <> inline MPI_Datatype mpiType<long long>() { return MPI_LONG_LONG; }
+template <> inline MPI_Datatype mpiType<unsigned long long>() { return MPI_UNSIGNED_LONG_LONG; }
+template <> inline MPI_Datatype mpiType<float>() { return MPI_FLOAT; }
+template <> inline MPI_Datatype mpiType<double>() { return MPI_DOUBLE; }
+
+// Sum of every rank's x[0 .. n), returned on all ranks
+template <typename T>
+typename SumType<T>::type allreduce(const T* x, size_t n, Strategy s, MPI_Comm comm, int threads = 0) {
+    typedef typename SumType<T>::type A;
+    if (threads <= 0) threads = detail::maxThreads();
+    if (s == Strategy::Pairwise || s == Strategy::Kahan) {
+        // Rank partials combined in rank order, so every rank gets the same bits
+        std::vector<PaddedSlot<A>> slots = detail::slotSums<A>(x, n, s, threads);
+        A local[2] = {0, 0};
+        for (const PaddedSlot<A>& slot : slots) {
+            if (s == Strategy::Kahan) {
+                detail::compensatedAdd(local[0], local[1], slot.sum);
+                local[1] += slot.compensation;
+            } else {
+                local[0] += slot.sum;
+            }
+        }
+        int size;
+        MPI_Comm_size(comm, &size);
+        std::vector<A> all(2 * size_t(size));
+        MPI_Allgather(local, 2, mpiType<A>(), all.data(), 2, mpiType<A>(), comm);
+        std::vector<PaddedSlot<A>> ranks(size);
+        for (int r = 0; r < size; r++) {
+            ranks[r].sum = all[2 * size_t(r)];
+            ranks[r].compensation = all[2 * size_t(r) + 1];
+        }
+        if (s == Strategy::Pairwise) {
+            // Pairwise over the rank partials as well
+            std::vector<A> partial(size);
+            for (int r = 0; r < size; r++) partial[r] = ranks[r].sum;
+            return detail::pairwise<A>(partial.data(), partial.size());
+        }
+        return detail::combine(s, ranks.data(), ranks.size());
+    }
+    A local = sum(x, n, s, threads), total = 0;
+    MPI_Allreduce(&local, &total, 1, mpiType<A>(), MPI_SUM, comm);
+    return total;
+}
+#endif
+
+} // namespace reduce
+
+#endif
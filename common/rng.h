@@ -0,0 +1,212 @@
+#ifndef SIT315_RNG_H
+#define SIT315_RNG_H
+
+// Counter-based input generators for the benchmarks.
+//
+// Element i of a stream is a pure function of (seed, i): a SplitMix64-style
+// hash of the seed and the index. Arrays can therefore be filled in
+// parallel, in any order and in pieces (e.g. one slice per MPI rank), and
+// the result depends only on the seed, never on the thread or rank count.
+// Nothing is shared between threads, unlike rand(), which takes a lock in
+// glibc.
+//
+// Integer distributions over [lo, hi):
+//   uniform     independent uniform keys
+//   sorted      an evenly spread non-decreasing ramp
+//   reverse     the same ramp, non-increasing
+//   few-unique  keys drawn from RNG_FEW_UNIQUE_KEYS random values
+//   zipf        lo + k - 1 with P(k) ~ 1 / k^s for k = 1 .. hi - lo, so lo is
+//               the most frequent key (rejection-inversion sampling,
+//               Hoermann & Derflinger)
+//
+// Plain C, usable from both the C and C++ programs; compile with -fopenmp
+// for the fills to run in parallel, and link C programs with -lm.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RNG_DEFAULT_SEED 42u
+#define RNG_FEW_UNIQUE_KEYS 16
+#define RNG_ZIPF_DEFAULT_S 1.0
+
+enum rng_dist {
+    RNG_UNIFORM = 0,
+    RNG_SORTED,
+    RNG_REVERSE,
+    RNG_FEW_UNIQUE,
+    RNG_ZIPF
+};
+
+static inline const char *rng_dist_name(enum rng_dist dist) {
+    switch (dist) {
+    case RNG_SORTED: return "sorted";
+    case RNG_REVERSE: return "reverse";
+    case RNG_FEW_UNIQUE: return "few-unique";
+    case RNG_ZIPF: return "zipf";
+    default: return "uniform";
+    }
+}
+
+// Returns 0 and sets *dist if name is one of the names above
+static inline int rng_parse_dist(const char *name, enum rng_dist *dist) {
+    for (int d = RNG_UNIFORM; d <= RNG_ZIPF; d++) {
+        if (strcmp(name, rng_dist_name((enum rng_dist)d)) == 0) {
+            *dist = (enum rng_dist)d;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static inline uint64_t rng_mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// 64 random bits for element i of stream seed
+static inline uint64_t rng_at(uint64_t seed, uint64_t i) {
+    return rng_mix64(rng_mix64(seed) + (i + 1) * 0x9e3779b97f4a7c15ull);
+}
+
+// Uniform in [0, range) for range <= 2^32, by multiply-shift on the high bits
+static inline uint64_t rng_bounded(uint64_t x, uint64_t range) {
+    return ((x >> 32) * range) >> 32;
+}
+
+// Uniform double in [0, 1)
+static inline double rng_unit(uint64_t x) {
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform float in [lo, hi)
+static inline float rng_float_at(uint64_t seed, uint64_t i, float lo, float hi) {
+    return lo + (hi - lo) * ((float)(rng_at(seed, i) >> 40) * (1.0f / 16777216.0f));
+}
+
+// A distribution with its parameters; build with rng_make_spec()
+typedef struct {
+    enum rng_dist dist;
+    uint64_t seed;
+    int lo;
+    uint64_t range;         // hi - lo
+    double zipf_s;          // Zipf exponent and precomputed sampler constants
+    double zipf_h_x1, zipf_h_n, zipf_s_const;
+} rng_spec;
+
+static inline double rng_zipf_helper1(double x) {
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+static inline double rng_zipf_helper2(double x) {
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+// Integral of the hat function 1 / x^s, and its inverse
+static inline double rng_zipf_h_integral(double x, double s) {
+    double log_x = log(x);
+    return rng_zipf_helper2((1.0 - s) * log_x) * log_x;
+}
+
+static inline double rng_zipf_h_integral_inverse(double x, double s) {
+    double t = x * (1.0 - s);
+    if (t < -1.0) t = -1.0;
+    return exp(rng_zipf_helper1(t) * x);
+}
+
+static inline rng_spec rng_make_zipf(uint64_t seed, int lo, int hi, double s) {
+    rng_spec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.dist = RNG_ZIPF;
+    spec.seed = seed;
+    spec.lo = lo;
+    spec.range = hi > lo ? (uint64_t)((int64_t)hi - lo) : 1;
+    spec.zipf_s = s;
+    spec.zipf_h_x1 = rng_zipf_h_integral(1.5, s) - 1.0;
+    spec.zipf_h_n = rng_zipf_h_integral((double)spec.range + 0.5, s);
+    spec.zipf_s_const = 2.0 - rng_zipf_h_integral_inverse(rng_zipf_h_integral(2.5, s) - exp(-s * log(2.0)), s);
+    return spec;
+}
+
+// Keys in [lo, hi); Zipf uses exponent RNG_ZIPF_DEFAULT_S
+static inline rng_spec rng_make_spec(enum rng_dist dist, uint64_t seed, int lo, int hi) {
+    if (dist == RNG_ZIPF) return rng_make_zipf(seed, lo, hi, RNG_ZIPF_DEFAULT_S);
+    rng_spec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.dist = dist;
+    spec.seed = seed;
+    spec.lo = lo;
+    spec.range = hi > lo ? (uint64_t)((int64_t)hi - lo) : 1;
+    return spec;
+}
+
+// Rank in [1, range] from the per-element stream x; usually one attempt
+static inline uint64_t rng_zipf_rank(const rng_spec *spec, uint64_t x) {
+    const double s = spec->zipf_s;
+    for (uint64_t attempt = 0;; attempt++) {
+        double u = spec->zipf_h_n + rng_unit(rng_at(x, attempt)) * (spec->zipf_h_x1 - spec->zipf_h_n);
+        double v = rng_zipf_h_integral_inverse(u, s);
+        double k = floor(v + 0.5);
+        if (k < 1.0) k = 1.0;
+        else if (k > (double)spec->range) k = (double)spec->range;
+        if (k - v <= spec->zipf_s_const || u >= rng_zipf_h_integral(k + 0.5, s) - exp(-s * log(k)))
+            return (uint64_t)k;
+    }
+}
+
+// Element i of an array of total elements
+static inline int rng_int_at(const rng_spec *spec, uint64_t i, uint64_t total) {
+    uint64_t offset;
+    switch (spec->dist) {
+    case RNG_SORTED:
+    case RNG_REVERSE: {
+        uint64_t k = spec->dist == RNG_SORTED ? i : total - 1 - i;
+        offset = (uint64_t)((double)k / (double)total * (double)spec->range);
+        if (offset >= spec->range) offset = spec->range - 1;
+        break;
+    }
+    case RNG_FEW_UNIQUE:
+        offset = rng_bounded(rng_at(~spec->seed, rng_bounded(rng_at(spec->seed, i), RNG_FEW_UNIQUE_KEYS)),
+                             spec->range);
+        break;
+    case RNG_ZIPF:
+        offset = rng_zipf_rank(spec, rng_at(spec->seed, i)) - 1;
+        break;
+    default:
+        offset = rng_bounded(rng_at(spec->seed, i), spec->range);
+        break;
+    }
+    return (int)((int64_t)spec->lo + (int64_t)offset);
+}
+
+// Elements [first, first + count) of a total-element array, in parallel
+static inline void rng_fill_ints_at(int *out, uint64_t first, size_t count, uint64_t total, const rng_spec *spec) {
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)count; i++)
+        out[i] = rng_int_at(spec, first + (uint64_t)i, total);
+}
+
+static inline void rng_fill_ints(int *out, size_t n, const rng_spec *spec) {
+    rng_fill_ints_at(out, 0, n, n, spec);
+}
+
+// A rows x cols block whose rows are stride elements apart (e.g. a padded
+// matrix), in parallel over rows; element (i, j) is element i * cols + j of
+// the stream
+static inline void rng_fill_ints_2d(int *out, size_t rows, size_t cols, size_t stride, const rng_spec *spec) {
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)rows; i++)
+        for (size_t j = 0; j < cols; j++)
+            out[(size_t)i * stride + j] = rng_int_at(spec, (uint64_t)i * cols + j, (uint64_t)rows * cols);
+}
+
+// Uniform floats in [lo, hi), in parallel
+static inline void rng_fill_floats(float *out, size_t n, uint64_t seed, float lo, float hi) {
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)n; i++)
+        out[i] = rng_float_at(seed, (uint64_t)i, lo, hi);
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef SIT315_STRASSEN_H
+#define SIT315_STRASSEN_H
+
+// Strassen-Winograd multiply for large square matrices (7 products and 15
+// additions per level instead of 8 products). Below the cutoff it falls back
+// to the blocked gemm::multiply from matrix.h. Exact for integer types; for
+// floating point the extra additions change rounding.
+//
+// All temporaries come from a StrassenArena sized up front, so the recursion
+// never allocates. The top taskDepth levels run their seven products as
+// OpenMP tasks (compile with -fopenmp); deeper levels use the sequential
+// schedule of Douglas et al., which needs only two n/2 x n/2 temporaries.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "matrix.h"
+
+namespace gemm {
+
+struct StrassenOptions {
+    int cutoff = 512;       // use the classical kernel at or below this size
+    int taskDepth = 1;      // recursion levels whose products run as tasks
+    int threads = 1;        // OpenMP threads for the task levels
+    BlockSizes blocks;      // blocking of the classical kernel
+};
+
+// Preallocated scratch memory, reusable across multiplies of the same size
+template <typename T>
+class StrassenArena {
+public:
+    StrassenArena() = default;
+    StrassenArena(const StrassenArena&) = delete;
+    StrassenArena& operator=(const StrassenArena&) = delete;
+    ~StrassenArena() { std::free(data_); }
+
+    T* reserve(size_t count) {
+        if (count > size_) {
+            std::free(data_);
+            size_t bytes = (std::max<size_t>(count, 1) * sizeof(T) + 63) / 64 * 64;
+            data_ = static_cast<T*>(std::aligned_alloc(64, bytes));
+            if (!data_) throw std::bad_alloc();
+            size_ = count;
+        }
+        return data_;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+namespace strassen_detail {
+
+template <typename T>
+void add(const T* X, size_t ldx, const T* Y, size_t ldy, T* Z, size_t ldz, int n) {
+    for (int i = 0; i < n; i++) {
+        const T* x = X + size_t(i) * ldx;
+        const T* y = Y + size_t(i) * ldy;
+        T* z = Z + size_t(i) * ldz;
+        for (int j = 0; j < n; j++) z[j] = x[j] + y[j];
+    }
+}
+
+template <typename T>
+void sub(const T* X, size_t ldx, const T* Y, size_t ldy, T* Z, size_t ldz, int n) {
+    for (int i = 0; i < n; i++) {
+        const T* x = X + size_t(i) * ldx;
+        const T* y = Y + size_t(i) * ldy;
+        T* z = Z + size_t(i) * ldz;
+        for (int j = 0; j < n; j++) z[j] = x[j] - y[j];
+    }
+}
+
+// Size after padding so that halving reaches the cutoff without odd sizes
+inline int paddedSize(int n, int cutoff) {
+    int base = n, levels = 0;
+    while (base > cutoff) {
+        base = (base + 1) / 2;
+        levels++;
+    }
+    return base << levels;
+}
+
+inline size_t sequentialScratch(int n, int cutoff) {
+    size_t total = 0;
+    for (; n > cutoff; n /= 2) total += 2 * size_t(n / 2) * (n / 2);
+    return total;
+}
+
+inline size_t taskScratch(int n, int cutoff, int depth) {
+    if (depth <= 0 || n <= cutoff) return sequentialScratch(n, cutoff);
+    size_t h2 = size_t(n / 2) * (n / 2);
+    return 11 * h2 + 7 * taskScratch(n / 2, cutoff, depth - 1);
+}
+
+// Sequential Winograd schedule: C = A * B using X and Y (h x h each) plus
+// the scratch of the recursive calls after them.
+template <typename T>
+void recurseSequential(const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc,
+                       int n, T* scratch, const StrassenOptions& opt) {
+    if (n <= opt.cutoff) {
+        multiply(A, lda, B, ldb, C, ldc, n, n, n, false, opt.blocks);
+        return;
+    }
+    const int h = n / 2;
+    const T *A11 = A, *A12 = A + h, *A21 = A + size_t(h) * lda, *A22 = A21 + h;
+    const T *B11 = B, *B12 = B + h, *B21 = B + size_t(h) * ldb, *B22 = B21 + h;
+    T *C11 = C, *C12 = C + h, *C21 = C + size_t(h) * ldc, *C22 = C21 + h;
+    T* X = scratch;
+    T* Y = X + size_t(h) * h;
+    T* rest = Y + size_t(h) * h;
+    const size_t ld = h;
+
+    sub(A11, lda, A21, lda, X, ld, h);                           // S3
+    sub(B22, ldb, B12, ldb, Y, ld, h);                           // T3
+    recurseSequential(X, ld, Y, ld, C21, ldc, h, rest, opt);     // P7
+    add(A21, lda, A22, lda, X, ld, h);                           // S1
+    sub(B12, ldb, B11, ldb, Y, ld, h);                           // T1
+    recurseSequential(X, ld, Y, ld, C22, ldc, h, rest, opt);     // P5
+    sub(X, ld, A11, lda, X, ld, h);                              // S2 = S1 - A11
+    sub(B22, ldb, Y, ld, Y, ld, h);                              // T2 = B22 - T1
+    recurseSequential(X, ld, Y, ld, C12, ldc, h, rest, opt);     // P6
+    sub(A12, lda, X, ld, X, ld, h);                              // S4 = A12 - S2
+    recurseSequential(X, ld, B22, ldb, C11, ldc, h, rest, opt);  // P3
+    recurseSequential(A11, lda, B11, ldb, X, ld, h, rest, opt);  // P1
+    add(X, ld, C12, ldc, C12, ldc, h);                           // U2 = P1 + P6
+    add(C12, ldc, C21, ldc, C21, ldc, h);                        // U3 = U2 + P7
+    add(C12, ldc, C22, ldc, C12, ldc, h);                        // U4 = U2 + P5
+    add(C21, ldc, C22, ldc, C22, ldc, h);                        // C22 = U3 + P5
+    add(C12, ldc, C11, ldc, C12, ldc, h);                        // C12 = U4 + P3
+    sub(Y, ld, B21, ldb, Y, ld, h);                              // T4 = T2 - B21
+    recurseSequential(A22, lda, Y, ld, C11, ldc, h, rest, opt);  // P4
+    sub(C21, ldc, C11, ldc, C21, ldc, h);                        // C21 = U3 - P4
+    recurseSequential(A12, lda, B21, ldb, C11, ldc, h, rest, opt); // P2
+    add(X, ld, C11, ldc, C11, ldc, h);                           // C11 = P1 + P2
+}
+
+// Task schedule: all S and T sums first, then the seven products as
+// independent tasks, each with its own slice of the arena.
+template <typename T>
+void recurseTasks(const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc,
+                  int n, T* scratch, const StrassenOptions& opt, int depth) {
+    if (depth <= 0 || n <= opt.cutoff) {
+        recurseSequential(A, lda, B, ldb, C, ldc, n, scratch, opt);
+        return;
+    }
+    const int h = n / 2;
+    const T *A11 = A, *A12 = A + h, *A21 = A + size_t(h) * lda, *A22 = A21 + h;
+    const T *B11 = B, *B12 = B + h, *B21 = B + size_t(h) * ldb, *B22 = B21 + h;
+    T *C11 = C, *C12 = C + h, *C21 = C + size_t(h) * ldc, *C22 = C21 + h;
+    const size_t ld = h, h2 = size_t(h) * h;
+    T *S1 = scratch, *S2 = S1 + h2, *S3 = S2 + h2, *S4 = S3 + h2;
+    T *T1 = S4 + h2, *T2 = T1 + h2, *T3 = T2 + h2, *T4 = T3 + h2;
+    T *P1 = T4 + h2, *P6 = P1 + h2, *P7 = P6 + h2;
+    T* child = P7 + h2;
+    const size_t childScratch = taskScratch(h, opt.cutoff, depth - 1);
+
+    add(A21, lda, A22, lda, S1, ld, h);
+    sub(S1, ld, A11, lda, S2, ld, h);
+    sub(A11, lda, A21, lda, S3, ld, h);
+    sub(A12, lda, S2, ld, S4, ld, h);
+    sub(B12, ldb, B11, ldb, T1, ld, h);
+    sub(B22, ldb, T1, ld, T2, ld, h);
+    sub(B22, ldb, B12, ldb, T3, ld, h);
+    sub(T2, ld, B21, ldb, T4, ld, h);
+
+    #pragma omp taskgroup
+    {
+        #pragma omp task
+        recurseTasks(A11, lda, B11, ldb, P1, ld, h, child + 0 * childScratch, opt, depth - 1);
+        #pragma omp task
+        recurseTasks(A12, lda, B21, ldb, C11, ldc, h, child + 1 * childScratch, opt, depth - 1);  // P2
+        #pragma omp task
+        recurseTasks(S4, ld, B22, ldb, C12, ldc, h, child + 2 * childScratch, opt, depth - 1);    // P3
+        #pragma omp task
+        recurseTasks(A22, lda, T4, ld, C21, ldc, h, child + 3 * childScratch, opt, depth - 1);    // P4
+        #pragma omp task
+        recurseTasks(S1, ld, T1, ld, C22, ldc, h, child + 4 * childScratch, opt, depth - 1);      // P5
+        #pragma omp task
+        recurseTasks(S2, ld, T2, ld, P6, ld, h, child + 5 * childScratch, opt, depth - 1);
+        recurseTasks(S3, ld, T3, ld, P7, ld, h, child + 6 * childScratch, opt, depth - 1);
+    }
+
+    add(C11, ldc, P1, ld, C11, ldc, h);     // C11 = P1 + P2
+    add(P6, ld, P1, ld, P6, ld, h);         // U2 = P1 + P6
+    add(P7, ld, P6, ld, P7, ld, h);         // U3 = U2 + P7
+    add(C12, ldc, P6, ld, C12, ldc, h);     // C12 = P3 + U2 + P5
+    add(C12, ldc, C22, ldc, C12, ldc, h);
+    add(C22, ldc, P7, ld, C22, ldc, h);     // C22 = U3 + P5
+    sub(P7, ld, C21, ldc, C21, ldc, h);     // C21 = U3 - P4
+}
+
+} // namespace strassen_detail
+
+// Arena elements needed by multiplyStrassen for n x n operands, including
+// the padded copies of A, B and C when n must be padded
+inline size_t strassenScratchSize(int n, const StrassenOptions& opt) {
+    using namespace strassen_detail;
+    const int cutoff = std::max(opt.cutoff, 1);
+    const int padded = paddedSize(n, cutoff);
+    size_t total = taskScratch(padded, cutoff, opt.threads > 1 ? opt.taskDepth : 0);
+    if (padded != n) total += 3 * size_t(padded) * padded;
+    return total;
+}
+
+// C = A * B. Non-square operands and sizes at or below the cutoff use the
+// classical kernel. Sizes that do not halve evenly down to the cutoff are
+// zero padded into the arena.
+template <typename T>
+void multiplyStrassen(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C,
+                      const StrassenOptions& opt, StrassenArena<T>& arena) {
+    using namespace strassen_detail;
+    const int n = A.rows();
+    if (A.cols() != n || B.rows() != n || B.cols() != n || n <= opt.cutoff || opt.cutoff < 1) {
+        multiplyRows(A, B, C, 0, C.rows(), opt.blocks);
+        return;
+    }
+    const int padded = paddedSize(n, opt.cutoff);
+    const int depth = opt.threads > 1 ? opt.taskDepth : 0;
+    T* scratch = arena.reserve(strassenScratchSize(n, opt));
+
+    const T *a = A.data(), *b = B.data();
+    T* c = C.data();
+    size_t lda = A.stride(), ldb = B.stride(), ldc = C.stride();
+    if (padded != n) {
+        const size_t p2 = size_t(padded) * padded;
+        T *pa = scratch, *pb = pa + p2, *pc = pb + p2;
+        scratch = pc + p2;
+        std::fill(pa, pa + 2 * p2, T(0));
+        for (int i = 0; i < n; i++) {
+            std::copy(A.row(i), A.row(i) + n, pa + size_t(i) * padded);
+            std::copy(B.row(i), B.row(i) + n, pb + size_t(i) * padded);
+        }
+        a = pa;
+        b = pb;
+        c = pc;
+        lda = ldb = ldc = padded;
+    }
+
+    if (depth > 0) {
+        #pragma omp parallel num_threads(opt.threads)
+        #pragma omp single
+        recurseTasks(a, lda, b, ldb, c, ldc, padded, scratch, opt, depth);
+    } else {
+        recurseSequential(a, lda, b, ldb, c, ldc, padded, scratch, opt);
+    }
+
+    if (padded != n)
+        for (int i = 0; i < n; i++) std::copy(c + size_t(i) * padded, c + size_t(i) * padded + n, C.row(i));
+}
+
+template <typename T>
+Matrix<T> multiplyStrassen(const Matrix<T>& A, const Matrix<T>& B, const StrassenOptions& opt = StrassenOptions()) {
+    StrassenArena<T> arena;
+    Matrix<T> C(A.rows(), B.cols());
+    multiplyStrassen(A, B, C, opt, arena);
+    return C;
+}
+
+} // namespace gemm
+
+#endif
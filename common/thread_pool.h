@@ -0,0 +1,164 @@
+#ifndef SIT315_THREAD_POOL_H
+#define SIT315_THREAD_POOL_H
+
+// Persistent pthread worker pool with per-worker task deques and work stealing.
+// Threads are created once; each run() call splits a job into indexed tasks,
+// deals contiguous ranges of them to the workers' deques and blocks until all
+// tasks have finished. Idle workers steal from the back of other deques, so
+// uneven tasks or shared cores do not leave threads waiting on a straggler.
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "numa_alloc.h"
+
+class ThreadPool {
+public:
+    // numThreads <= 0 uses every online CPU. With pinThreads, worker i binds
+    // itself to the i-th CPU the process may run on (numa_pin_thread), before
+    // it runs any task, so a taskset or mpirun mask is kept.
+    explicit ThreadPool(int numThreads = 0, bool pinThreads = false) : stop_(false), queued_(0), remaining_(0) {
+        if (numThreads <= 0) numThreads = onlineCpus();
+        pthread_mutex_init(&mutex_, nullptr);
+        pthread_cond_init(&workCond_, nullptr);
+        pthread_cond_init(&doneCond_, nullptr);
+        workers_.resize(numThreads);
+        for (int i = 0; i < numThreads; i++) {
+            workers_[i].pool = this;
+            workers_[i].id = i;
+            workers_[i].pinned = pinThreads;
+            pthread_mutex_init(&workers_[i].lock, nullptr);
+        }
+        for (int i = 0; i < numThreads; i++) {
+            pthread_create(&workers_[i].thread, nullptr, workerMain, &workers_[i]);
+        }
+    }
+
+    ~ThreadPool() {
+        pthread_mutex_lock(&mutex_);
+        stop_ = true;
+        pthread_cond_broadcast(&workCond_);
+        pthread_mutex_unlock(&mutex_);
+        for (auto& w : workers_) pthread_join(w.thread, nullptr);
+        for (auto& w : workers_) pthread_mutex_destroy(&w.lock);
+        pthread_cond_destroy(&doneCond_);
+        pthread_cond_destroy(&workCond_);
+        pthread_mutex_destroy(&mutex_);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return int(workers_.size()); }
+
+    // Execute task(i) for every i in [0, count) on the pool and wait for all of
+    // them. Only one job runs at a time; calls from several threads serialise.
+    void run(int count, const std::function<void(int)>& task) {
+        if (count <= 0) return;
+        pthread_mutex_lock(&mutex_);
+        while (remaining_.load() > 0) pthread_cond_wait(&doneCond_, &mutex_);
+        task_ = &task;
+        remaining_.store(count);
+        queued_.store(count);
+        int n = size();
+        for (int w = 0; w < n; w++) {
+            int begin = int(long(count) * w / n);
+            int end = int(long(count) * (w + 1) / n);
+            pthread_mutex_lock(&workers_[w].lock);
+            for (int i = begin; i < end; i++) workers_[w].tasks.push_back(i);
+            pthread_mutex_unlock(&workers_[w].lock);
+        }
+        pthread_cond_broadcast(&workCond_);
+        while (remaining_.load() > 0) pthread_cond_wait(&doneCond_, &mutex_);
+        task_ = nullptr;
+        pthread_cond_broadcast(&doneCond_);
+        pthread_mutex_unlock(&mutex_);
+    }
+
+    static int onlineCpus() {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return n > 0 ? int(n) : 1;
+    }
+
+private:
+    struct Worker {
+        ThreadPool* pool;
+        int id;
+        bool pinned;
+        pthread_t thread;
+        pthread_mutex_t lock;
+        std::deque<int> tasks;
+    };
+
+    // Owner takes from the front of its deque, keeping neighbouring tiles together.
+    bool popLocal(Worker& w, int& task) {
+        pthread_mutex_lock(&w.lock);
+        bool found = !w.tasks.empty();
+        if (found) {
+            task = w.tasks.front();
+            w.tasks.pop_front();
+        }
+        pthread_mutex_unlock(&w.lock);
+        return found;
+    }
+
+    // Thieves take from the back, i.e. the work the owner would reach last.
+    bool steal(Worker& self, int& task) {
+        int n = size();
+        for (int k = 1; k < n; k++) {
+            Worker& victim = workers_[(self.id + k) % n];
+            pthread_mutex_lock(&victim.lock);
+            bool found = !victim.tasks.empty();
+            if (found) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+            }
+            pthread_mutex_unlock(&victim.lock);
+            if (found) return true;
+        }
+        return false;
+    }
+
+    static void* workerMain(void* arg) {
+        Worker& self = *static_cast<Worker*>(arg);
+        ThreadPool& pool = *self.pool;
+        if (self.pinned && numa_pin_thread(self.id) < 0)
+            std::fprintf(stderr, "Warning: could not pin worker %d\n", self.id);
+        for (;;) {
+            int task;
+            if (pool.popLocal(self, task) || pool.steal(self, task)) {
+                pool.queued_.fetch_sub(1);
+                (*pool.task_)(task);
+                if (pool.remaining_.fetch_sub(1) == 1) {
+                    pthread_mutex_lock(&pool.mutex_);
+                    pthread_cond_broadcast(&pool.doneCond_);
+                    pthread_mutex_unlock(&pool.mutex_);
+                }
+                continue;
+            }
+            pthread_mutex_lock(&pool.mutex_);
+            while (!pool.stop_ && pool.queued_.load() == 0) pthread_cond_wait(&pool.workCond_, &pool.mutex_);
+            bool done = pool.stop_ && pool.queued_.load() == 0;
+            pthread_mutex_unlock(&pool.mutex_);
+            if (done) break;
+        }
+        return nullptr;
+    }
+
+    std::vector<Worker> workers_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t workCond_;
+    pthread_cond_t doneCond_;
+    bool stop_;
+    std::atomic<int> queued_;
+    std::atomic<int> remaining_;
+    const std::function<void(int)>* task_ = nullptr;
+};
+
+#endif
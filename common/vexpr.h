@@ -0,0 +1,343 @@
+#ifndef SIT315_VEXPR_H
+#define SIT315_VEXPR_H
+
+// Fused elementwise vector expressions.
+//
+// Arithmetic on vexpr::Span views builds an expression tree instead of
+// computing anything, e.g. span(A) + span(B) or 2.0f * span(X) + span(Y).
+// The tree is evaluated in a single OpenMP-parallel, SIMD loop when it is
+// assigned or reduced, so chains that would otherwise be separate passes
+// over memory run as one:
+//
+//   vexpr::span(C) = vexpr::span(A) + vexpr::span(B);             // C = A + B
+//   double s = vexpr::assignSum(vexpr::span(C), span(A) + span(B)); // and sum(C)
+//   double d = vexpr::assignDot(y, a * x + y, z);                  // axpy, dot(y, z)
+//
+// Each element is read and written once, with no temporaries, so a memory-
+// bound chain such as add-then-sum moves half the bytes of two loops.
+//
+// The same tree can be turned into OpenCL C source (clAssign, clAssignSum)
+// so the device runs the identical fused expression; see ClKernel for the
+// argument layout. Header-only; compile with -fopenmp (or -fopenmp-simd) for
+// the loops to run in parallel and vectorize.
+
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace vexpr {
+
+// Accumulator for sums: 64-bit for integers, double for float
+template <typename T> struct Accumulator { typedef T type; };
+template <> struct Accumulator<int> { typedef long long type; };
+template <> struct Accumulator<unsigned> { typedef unsigned long long type; };
+template <> struct Accumulator<float> { typedef double type; };
+
+// OpenCL C spelling of a scalar type
+template <typename T> struct ClType;
+template <> struct ClType<int> { static const char* name() { return "int"; } };
+template <> struct ClType<unsigned> { static const char* name() { return "uint"; } };
+template <> struct ClType<long long> { static const char* name() { return "long"; } };
+template <> struct ClType<float> { static const char* name() { return "float"; } };
+template <> struct ClType<double> { static const char* name() { return "double"; } };
+
+// Device-side accumulator: like Accumulator, but float stays float since
+// double is optional in OpenCL
+template <typename T> struct ClAccumulator { typedef typename Accumulator<T>::type type; };
+template <> struct ClAccumulator<float> { typedef float type; };
+
+// Collects the arrays an expression reads while it is printed as OpenCL C;
+// each distinct host pointer becomes one kernel argument a0, a1, ...
+class ClBuilder {
+public:
+    std::string array(const void* data, const char* type) {
+        size_t k = 0;
+        while (k < arrays.size() && arrays[k] != data) k++;
+        if (k == arrays.size()) {
+            arrays.push_back(data);
+            types.push_back(type);
+        }
+        return "a" + std::to_string(k) + "[i]";
+    }
+
+    std::vector<const void*> arrays;
+    std::vector<std::string> types;
+};
+
+// CRTP base of every expression node
+template <typename E>
+struct Expr {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// Non-owning view of n contiguous elements; the leaf of an expression, and
+// the target of assignments
+template <typename T>
+class Span : public Expr<Span<T>> {
+public:
+    typedef typename std::remove_const<T>::type value_type;
+
+    Span(T* data, size_t n) : data_(data), n_(n) {}
+    Span(const Span& other) = default;
+
+    size_t size() const { return n_; }
+    T* data() const { return data_; }
+    T operator[](size_t i) const { return data_[i]; }
+    std::string cl(ClBuilder& b) const { return b.array(data_, ClType<value_type>::name()); }
+
+    template <typename E>
+    Span& operator=(const Expr<E>& e);
+
+    // Copies elements, like any other assignment, rather than rebinding
+    Span& operator=(const Span& other) { return operator=<Span>(other); }
+
+private:
+    T* data_;
+    size_t n_;
+};
+
+template <typename T>
+Span<T> span(T* data, size_t n) { return Span<T>(data, n); }
+
+template <typename T>
+Span<T> span(std::vector<T>& v) { return Span<T>(v.data(), v.size()); }
+
+template <typename T>
+Span<const T> span(const std::vector<T>& v) { return Span<const T>(v.data(), v.size()); }
+
+// A constant broadcast to every element; its size is 0 (matches anything)
+template <typename T>
+class Scalar : public Expr<Scalar<T>> {
+public:
+    typedef T value_type;
+
+    explicit Scalar(T value) : value_(value) {}
+
+    size_t size() const { return 0; }
+    T operator[](size_t) const { return value_; }
+
+    // Baked into the source as a literal; hex floats are exact
+    std::string cl(ClBuilder&) const {
+        char text[64];
+        if (std::is_floating_point<T>::value)
+            snprintf(text, sizeof(text), "((%s)%a)", ClType<T>::name(), (double)value_);
+        else
+            snprintf(text, sizeof(text), "((%s)%lld)", ClType<T>::name(), (long long)value_);
+        return text;
+    }
+
+private:
+    T value_;
+};
+
+inline void checkSize(size_t expected, size_t actual) {
+    if (actual != 0 && actual != expected)
+        throw std::invalid_argument("vexpr: operand sizes differ (" + std::to_string(expected) + " vs " +
+                                    std::to_string(actual) + ")");
+}
+
+struct Add { template <typename A, typename B> static auto apply(A a, B b) -> decltype(a + b) { return a + b; } static const char* op() { return "+"; } };
+struct Sub { template <typename A, typename B> static auto apply(A a, B b) -> decltype(a - b) { return a - b; } static const char* op() { return "-"; } };
+struct Mul { template <typename A, typename B> static auto apply(A a, B b) -> decltype(a * b) { return a * b; } static const char* op() { return "*"; } };
+struct Div { template <typename A, typename B> static auto apply(A a, B b) -> decltype(a / b) { return a / b; } static const char* op() { return "/"; } };
+
+// Operands are held by value: leaves and scalars are a pointer or a number,
+// so a tree built from temporaries stays valid after the full expression
+template <typename Op, typename L, typename R>
+class Binary : public Expr<Binary<Op, L, R>> {
+public:
+    typedef decltype(Op::apply(typename L::value_type(), typename R::value_type())) value_type;
+
+    Binary(const L& l, const R& r) : l_(l), r_(r) {
+        if (l_.size() != 0) checkSize(l_.size(), r_.size());
+    }
+
+    size_t size() const { return l_.size() != 0 ? l_.size() : r_.size(); }
+    value_type operator[](size_t i) const { return Op::apply(l_[i], r_[i]); }
+
+    // Left before right, so arguments are numbered in reading order
+    std::string cl(ClBuilder& b) const {
+        std::string left = l_.cl(b);
+        std::string right = r_.cl(b);
+        return "(" + left + " " + Op::op() + " " + right + ")";
+    }
+
+private:
+    L l_;
+    R r_;
+};
+
+#define VEXPR_BINARY_OPERATOR(symbol, Op)                                                              \
+    template <typename L, typename R>                                                                  \
+    Binary<Op, L, R> operator symbol(const Expr<L>& l, const Expr<R>& r) {                             \
+        return Binary<Op, L, R>(l.self(), r.self());                                                   \
+    }                                                                                                  \
+    template <typename L, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type> \
+    Binary<Op, L, Scalar<S>> operator symbol(const Expr<L>& l, S s) {                                  \
+        return Binary<Op, L, Scalar<S>>(l.self(), Scalar<S>(s));                                       \
+    }                                                                                                  \
+    template <typename S, typename R, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type> \
+    Binary<Op, Scalar<S>, R> operator symbol(S s, const Expr<R>& r) {                                  \
+        return Binary<Op, Scalar<S>, R>(Scalar<S>(s), r.self());                                       \
+    }
+
+VEXPR_BINARY_OPERATOR(+, Add)
+VEXPR_BINARY_OPERATOR(-, Sub)
+VEXPR_BINARY_OPERATOR(*, Mul)
+VEXPR_BINARY_OPERATOR(/, Div)
+
+#undef VEXPR_BINARY_OPERATOR
+
+// dst[i] = e[i]. dst may also appear in e: element i is read before it is
+// written, and never by another iteration.
+template <typename T, typename E>
+void assign(Span<T> dst, const Expr<E>& expr) {
+    const E& e = expr.self();
+    checkSize(dst.size(), e.size());
+    T* out = dst.data();
+    const long long n = (long long)dst.size();
+    #pragma omp parallel for simd schedule(static)
+    for (long long i = 0; i < n; i++) out[i] = T(e[i]);
+}
+
+template <typename T>
+template <typename E>
+Span<T>& Span<T>::operator=(const Expr<E>& e) {
+    assign(*this, e);
+    return *this;
+}
+
+template <typename E>
+typename Accumulator<typename E::value_type>::type sum(const Expr<E>& expr) {
+    typedef typename Accumulator<typename E::value_type>::type Acc;
+    const E& e = expr.self();
+    const long long n = (long long)e.size();
+    Acc total = 0;
+    #pragma omp parallel for simd schedule(static) reduction(+:total)
+    for (long long i = 0; i < n; i++) total += Acc(e[i]);
+    return total;
+}
+
+template <typename L, typename R>
+typename Accumulator<typename Binary<Mul, L, R>::value_type>::type dot(const Expr<L>& a, const Expr<R>& b) {
+    checkSize(a.self().size(), b.self().size());
+    return sum(a * b);
+}
+
+// dst = e, returning sum(dst), in one pass
+template <typename T, typename E>
+typename Accumulator<T>::type assignSum(Span<T> dst, const Expr<E>& expr) {
+    typedef typename Accumulator<T>::type Acc;
+    const E& e = expr.self();
+    checkSize(dst.size(), e.size());
+    T* out = dst.data();
+    const long long n = (long long)dst.size();
+    Acc total = 0;
+    #pragma omp parallel for simd schedule(static) reduction(+:total)
+    for (long long i = 0; i < n; i++) {
+        T v = T(e[i]);
+        out[i] = v;
+        total += Acc(v);
+    }
+    return total;
+}
+
+// dst = e, returning dot(dst, w), in one pass (e.g. axpy followed by a dot)
+template <typename T, typename E, typename W>
+typename Accumulator<T>::type assignDot(Span<T> dst, const Expr<E>& expr, const Expr<W>& weights) {
+    typedef typename Accumulator<T>::type Acc;
+    const E& e = expr.self();
+    const W& w = weights.self();
+    checkSize(dst.size(), e.size());
+    checkSize(dst.size(), w.size());
+    T* out = dst.data();
+    const long long n = (long long)dst.size();
+    Acc total = 0;
+    #pragma omp parallel for simd schedule(static) reduction(+:total)
+    for (long long i = 0; i < n; i++) {
+        T v = T(e[i]);
+        out[i] = v;
+        total += Acc(v) * Acc(w[i]);
+    }
+    return total;
+}
+
+// Generated OpenCL kernel for an assignment. Arguments:
+//   0            __global T* out
+//   1 .. k       __global const T_j* a_j, the host arrays in `arrays` order
+//   k + 1        (clAssignSum only) __global Acc* partial, one per group
+//   last         int n
+// clAssign runs one work-item per element and respects a global offset, so
+// it can be streamed in chunks. clAssignSum must be launched without an
+// offset with `local` work-items per group; each group loops over the array
+// with stride get_global_size(0) and leaves its partial sum in partial[group].
+struct ClKernel {
+    std::string name;
+    std::string source;
+    std::vector<const void*> arrays;
+};
+
+template <typename T>
+std::string clSignature(const std::string& name, const ClBuilder& b, bool partials) {
+    std::string sig = "__kernel void " + name + "(__global " + ClType<T>::name() + "* out";
+    for (size_t k = 0; k < b.arrays.size(); k++)
+        sig += ", __global const " + b.types[k] + "* a" + std::to_string(k);
+    if (partials) sig += std::string(", __global ") + ClType<typename ClAccumulator<T>::type>::name() + "* partial";
+    return sig + ", const int n)";
+}
+
+template <typename T, typename E>
+ClKernel clAssign(const std::string& name, Span<T> dst, const Expr<E>& expr) {
+    typedef typename std::remove_const<T>::type V;
+    checkSize(dst.size(), expr.self().size());
+    ClBuilder b;
+    std::string value = expr.self().cl(b);
+    ClKernel k;
+    k.name = name;
+    k.source = clSignature<V>(name, b, false) + " {\n"
+               "    int i = get_global_id(0);\n"
+               "    if (i < n) out[i] = (" + std::string(ClType<V>::name()) + ")" + value + ";\n"
+               "}\n";
+    k.arrays = b.arrays;
+    return k;
+}
+
+template <typename T, typename E>
+ClKernel clAssignSum(const std::string& name, Span<T> dst, const Expr<E>& expr, int local = 256) {
+    typedef typename std::remove_const<T>::type V;
+    const std::string acc = ClType<typename ClAccumulator<V>::type>::name();
+    const std::string lanes = std::to_string(local);
+    checkSize(dst.size(), expr.self().size());
+    if (local <= 0 || (local & (local - 1)) != 0)
+        throw std::invalid_argument("vexpr: work-group size must be a power of two");
+    ClBuilder b;
+    std::string value = expr.self().cl(b);
+    ClKernel k;
+    k.name = name;
+    k.source = clSignature<V>(name, b, true) + " {\n"
+               "    __local " + acc + " scratch[" + lanes + "];\n"
+               "    int lid = get_local_id(0);\n"
+               "    " + acc + " total = 0;\n"
+               "    for (int i = get_global_id(0); i < n; i += get_global_size(0)) {\n"
+               "        " + ClType<V>::name() + " v = (" + ClType<V>::name() + ")" + value + ";\n"
+               "        out[i] = v;\n"
+               "        total += v;\n"
+               "    }\n"
+               "    scratch[lid] = total;\n"
+               "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+               "    for (int s = " + lanes + " / 2; s > 0; s >>= 1) {\n"
+               "        if (lid < s) scratch[lid] += scratch[lid + s];\n"
+               "        barrier(CLK_LOCAL_MEM_FENCE);\n"
+               "    }\n"
+               "    if (lid == 0) partial[get_group_id(0)] = scratch[0];\n"
+               "}\n";
+    k.arrays = b.arrays;
+    return k;
+}
+
+} // namespace vexpr
+
+#endif
@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include "../common/matrix_io.h"
+
+// Converts a binary matrix file (common/matrix_io.h) to the old text layout:
+// one row per line, values separated by spaces.
+//
+// Usage: matrix2txt input.bin [output.txt]   (stdout when no output is given)
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s input.bin [output.txt]\n", argv[0]);
+        return 1;
+    }
+
+    matrix_mapping m;
+    if (matrix_map(argv[1], &m) != 0) return 1;
+
+    FILE* out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Cannot open %s\n", argv[2]);
+        matrix_unmap(&m);
+        return 1;
+    }
+
+    size_t rows = m.header->rows, cols = m.header->cols;
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            size_t k = i * cols + j;
+            switch (m.header->dtype) {
+            case MATRIX_INT32: fprintf(out, "%d ", ((const int32_t*)m.data)[k]); break;
+            case MATRIX_FLOAT32: fprintf(out, "%.2f ", ((const float*)m.data)[k]); break;
+            case MATRIX_FLOAT64: fprintf(out, "%.2f ", ((const double*)m.data)[k]); break;
+            }
+        }
+        fprintf(out, "\n");
+    }
+
+    if (out != stdout) fclose(out);
+    matrix_unmap(&m);
+    return 0;
+}
@@ -0,0 +1,370 @@
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "../common/bench.h"
+#include "../common/gemm_parallel.h"
+#include "../common/matrix.h"
+#include "../common/numa_alloc.h"
+#include "../common/quicksort.h"
+#include "../common/radix_sort.h"
+#include "../common/rng.h"
+#include "../common/vexpr.h"
+
+// Host roofline benchmark. Measures the machine ceilings first: STREAM
+// copy / scale / add / triad bandwidth and the peak FMA rate of all threads,
+// in double and in single precision (twice as many SIMD lanes).
+// Then it times the repo's kernels against those ceilings: the vector add
+// and reductions from common/vexpr.h, the blocked GEMM, a heat-diffusion
+// stencil step and the two parallel sorts. Each kernel is warmed up and
+// repeated. The report gives median and p99 time, GB/s and GFLOP/s from the
+// median, arithmetic intensity, and the percentage of the roofline bound
+// min(peak FLOP/s, intensity * peak bandwidth), with the FMA peak of the
+// kernel's own precision. Kernels without floating point work (copy, sorts)
+// are rated against bandwidth alone.
+//
+// Byte counts are the compulsory traffic of each kernel (every array read or
+// written once), so a kernel that needs more passes shows up as a lower
+// percentage; for the sorts they are a lower bound.
+//
+// Usage: roofline [--n N] [--gemm M] [--grid G] [--sort N] [--iterations I]
+//                 [--warmup W] [--threads T] [--json PATH] [--quick]
+// Build: g++ -O3 -march=native -fopenmp roofline.cpp -o roofline
+//
+// A table goes to stdout, the full results as JSON to PATH
+// (default roofline.json).
+
+#define STREAM_SCALAR 3.0
+#define FMA_LANES 128           // independent double FMA chains per thread, enough to hide latency
+#define HEAT_ALPHA 0.1          // as in Task M4_T1D/heatDiffusion/heat_sim.c
+
+struct Options {
+    size_t n = size_t(1) << 24;         // STREAM / vector elements (doubles)
+    int gemm = 1024;
+    int grid = 4096;
+    size_t sort = size_t(1) << 24;
+    int iterations = 20;
+    int warmup = 3;
+    int threads = 0;
+    std::string json = "roofline.json";
+};
+
+struct Machine {
+    double peakGBs = 0;
+    double peakGflops = 0;      // double precision
+    double peakGflopsF32 = 0;
+};
+
+struct Result {
+    std::string name;
+    std::string group;      // "stream" rows define the bandwidth ceiling
+    size_t items;           // elements / keys / output points processed
+    double bytes;
+    double flops;
+    bench::Stats stats;
+    bool f32 = false;       // single precision: rated against the float FMA peak
+};
+
+double computePeak(const Result& r, const Machine& m) {
+    return r.f32 ? m.peakGflopsF32 : m.peakGflops;
+}
+
+// Independent accumulators per thread: the same number of vector registers
+// for either precision
+template <typename T>
+constexpr int fmaLanes() {
+    return FMA_LANES * int(sizeof(double) / sizeof(T));
+}
+
+// Chained multiply-adds on fmaLanes<T>() independent accumulators; the
+// compiler keeps them in vector registers
+template <typename T>
+double fmaChains(long reps, T m, T c) {
+    T acc[fmaLanes<T>()];
+    for (int j = 0; j < fmaLanes<T>(); j++) acc[j] = T(1) + T(j) * T(1e-3);
+    for (long r = 0; r < reps; r++) {
+        #pragma omp simd
+        for (int j = 0; j < fmaLanes<T>(); j++) acc[j] = acc[j] * m + c;
+    }
+    double sum = 0;
+    for (int j = 0; j < fmaLanes<T>(); j++) sum += acc[j];
+    return sum;
+}
+
+double* allocDoubles(size_t n) {
+    double* p = static_cast<double*>(numa_buffer_alloc(n * sizeof(double), 0));
+    if (!p) {
+        std::fprintf(stderr, "Cannot allocate %zu doubles\n", n);
+        std::exit(1);
+    }
+    return p;
+}
+
+void printRow(const Result& r, const Machine& m) {
+    double t = r.stats.median;
+    double gbs = r.bytes / t / 1e9, gflops = r.flops / t / 1e9;
+    double pct = 0;
+    if (m.peakGBs > 0) {
+        double bound = r.flops > 0 ? std::min(computePeak(r, m), r.flops / r.bytes * m.peakGBs) : m.peakGBs;
+        pct = 100.0 * (r.flops > 0 ? gflops : gbs) / bound;
+    }
+    std::printf("%-22s %12.3f %12.3f %9.2f %9.2f %8.3f %7.1f%%\n", r.name.c_str(), t * 1e3, r.stats.p99 * 1e3, gbs,
+                gflops, r.bytes > 0 ? r.flops / r.bytes : 0.0, pct);
+}
+
+void writeResult(bench::JsonWriter& json, const Result& r, const Machine& m) {
+    double t = r.stats.median;
+    double gbs = r.bytes / t / 1e9, gflops = r.flops / t / 1e9;
+    double intensity = r.bytes > 0 ? r.flops / r.bytes : 0;
+    double bound = r.flops > 0 ? std::min(computePeak(r, m), intensity * m.peakGBs) : m.peakGBs;
+    json.beginObject();
+    json.field("name", r.name);
+    json.field("items", (long long)r.items);
+    json.field("bytes", r.bytes);
+    json.field("flops", r.flops);
+    json.stats("time", r.stats);
+    json.field("gbs", gbs);
+    json.field("best_gbs", r.bytes / r.stats.min / 1e9);
+    json.field("gflops", gflops);
+    json.field("items_per_s", double(r.items) / t);
+    json.field("intensity", intensity);
+    json.field("precision", r.f32 ? "f32" : "f64");
+    json.field("bound", r.flops > 0 ? (bound < computePeak(r, m) ? "memory" : "compute") : "memory");
+    json.field("roofline_pct", 100.0 * (r.flops > 0 ? gflops : gbs) / bound);
+    json.endObject();
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+            opt.n = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--gemm") == 0 && i + 1 < argc) {
+            opt.gemm = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            opt.grid = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            opt.sort = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            opt.iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            opt.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opt.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            opt.json = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            opt.n = size_t(1) << 21;
+            opt.gemm = 256;
+            opt.grid = 1024;
+            opt.sort = size_t(1) << 20;
+            opt.iterations = 5;
+            opt.warmup = 1;
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--n N] [--gemm M] [--grid G] [--sort N] [--iterations I] [--warmup W]\n"
+                         "          [--threads T] [--json PATH] [--quick]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+    if (opt.n < 1 || opt.gemm < 1 || opt.grid < 3 || opt.sort < 1 || opt.iterations < 1 || opt.warmup < 0) {
+        std::fprintf(stderr, "Sizes and --iterations must be positive, --grid at least 3\n");
+        return 1;
+    }
+    if (opt.threads > 0) omp_set_num_threads(opt.threads);
+    const int threads = omp_get_max_threads();
+    numa_pin_openmp_threads();
+
+    std::vector<Result> results;
+    Machine machine;
+    const size_t n = opt.n;
+    const int W = opt.warmup, I = opt.iterations;
+
+    // --- STREAM, on first-touched arrays ---
+    double* a = allocDoubles(n);
+    double* b = allocDoubles(n);
+    double* c = allocDoubles(n);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++) {
+        a[i] = 1.0;
+        b[i] = 2.0;
+        c[i] = 0.0;
+    }
+    const double s = STREAM_SCALAR;
+    const double B8 = double(sizeof(double)) * n;
+    results.push_back({"stream_copy", "stream", n, 2 * B8, 0, bench::measure(W, I, [&] {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; i++) c[i] = a[i];
+    })});
+    results.push_back({"stream_scale", "stream", n, 2 * B8, double(n), bench::measure(W, I, [&] {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; i++) b[i] = s * c[i];
+    })});
+    results.push_back({"stream_add", "stream", n, 3 * B8, double(n), bench::measure(W, I, [&] {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; i++) c[i] = a[i] + b[i];
+    })});
+    results.push_back({"stream_triad", "stream", n, 3 * B8, 2.0 * n, bench::measure(W, I, [&] {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; i++) a[i] = b[i] + s * c[i];
+    })});
+    // STREAM convention: the ceiling is the best rate seen
+    for (const Result& r : results) machine.peakGBs = std::max(machine.peakGBs, r.bytes / r.stats.min / 1e9);
+
+    // --- Peak FMA rate, double and single precision ---
+    const long reps = 1L << 21;
+    volatile double mul = 0.999999, add = 1e-7;
+    volatile float mulF = 0.999999f, addF = 1e-7f;
+    volatile double sink = 0;   // keeps reduction results from being optimised away
+    bench::Stats peak = bench::measure(W, I, [&] {
+        double m = mul, k = add, total = 0;
+        #pragma omp parallel reduction(+:total)
+        total += fmaChains(reps, m, k);
+        sink = sink + total;
+    });
+    bench::Stats peakF32 = bench::measure(W, I, [&] {
+        float m = mulF, k = addF;
+        double total = 0;
+        #pragma omp parallel reduction(+:total)
+        total += fmaChains(reps, m, k);
+        sink = sink + total;
+    });
+    machine.peakGflops = 2.0 * fmaLanes<double>() * double(reps) * threads / peak.min / 1e9;
+    machine.peakGflopsF32 = 2.0 * fmaLanes<float>() * double(reps) * threads / peakF32.min / 1e9;
+
+    // --- Vector kernels (common/vexpr.h) on the STREAM arrays ---
+    vexpr::Span<double> va(a, n), vb(b, n), vc(c, n);
+    results.push_back({"vector_add", "kernel", n, 3 * B8, double(n), bench::measure(W, I, [&] {
+        vc = va + vb;
+    })});
+    results.push_back({"sum", "kernel", n, B8, double(n), bench::measure(W, I, [&] {
+        sink = sink + vexpr::sum(va);
+    })});
+    results.push_back({"dot", "kernel", n, 2 * B8, 2.0 * n, bench::measure(W, I, [&] {
+        sink = sink + vexpr::dot(va, vb);
+    })});
+    results.push_back({"add_then_sum", "kernel", n, 3 * B8, 2.0 * n, bench::measure(W, I, [&] {
+        vc = va + vb;
+        sink = sink + vexpr::sum(vc);
+    })});
+    results.push_back({"fused_add_sum", "kernel", n, 3 * B8, 2.0 * n, bench::measure(W, I, [&] {
+        sink = sink + vexpr::assignSum(vc, va + vb);
+    })});
+    numa_buffer_free(a, n * sizeof(double));
+    numa_buffer_free(b, n * sizeof(double));
+    numa_buffer_free(c, n * sizeof(double));
+
+    // --- GEMM (common/matrix.h, OpenMP driver), single precision ---
+    {
+        const int m = opt.gemm;
+        Matrix<float> A(m, m), Bm(m, m), C(m, m);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < m; j++) {
+                A(i, j) = float((i + j) % 7) * 0.25f;
+                Bm(i, j) = float((i * 3 + j) % 5) * 0.5f;
+            }
+        double mm = double(m) * m;
+        results.push_back({"gemm_f32", "kernel", size_t(mm), 3 * mm * sizeof(float), 2 * mm * m,
+                           bench::measure(W, I, [&] { gemm::multiplyOpenMP(A, Bm, C, threads); }), true});
+    }
+
+    // --- Heat-diffusion stencil: one Jacobi step of the 5-point update ---
+    {
+        const size_t g = opt.grid;
+        double* u = allocDoubles(g * g);
+        double* v = allocDoubles(g * g);
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < g; i++)
+            for (size_t j = 0; j < g; j++) u[i * g + j] = v[i * g + j] = (i == g / 2 && j == g / 2) ? 100.0 : 20.0;
+        size_t inner = (g - 2) * (g - 2);
+        results.push_back({"stencil_5pt", "kernel", inner, 2.0 * sizeof(double) * inner, 7.0 * inner,
+                           bench::measure(W, I, [&] {
+            #pragma omp parallel for schedule(static)
+            for (size_t i = 1; i < g - 1; i++) {
+                const double* up = u + (i - 1) * g;
+                const double* row = u + i * g;
+                const double* down = u + (i + 1) * g;
+                double* out = v + i * g;
+                #pragma omp simd
+                for (size_t j = 1; j < g - 1; j++)
+                    out[j] = row[j] + HEAT_ALPHA * (up[j] + down[j] + row[j - 1] + row[j + 1] - 4.0 * row[j]);
+            }
+            std::swap(u, v);
+        })});
+        numa_buffer_free(u, g * g * sizeof(double));
+        numa_buffer_free(v, g * g * sizeof(double));
+    }
+
+    // --- Sorts (common/quicksort.h, common/radix_sort.h); input reloaded untimed ---
+    {
+        const size_t k = opt.sort;
+        std::vector<int> source(k), work(k);
+        rng_spec spec = rng_make_spec(RNG_UNIFORM, RNG_DEFAULT_SEED, 0, 1 << 30);
+        rng_fill_ints(source.data(), k, &spec);
+        auto reload = [&] { std::copy(source.begin(), source.end(), work.begin()); };
+        double bytes = 2.0 * sizeof(int) * k;
+        results.push_back({"quicksort", "kernel", k, bytes, 0, bench::measure(W, I, reload, [&] {
+            sorting::parallelQuicksort(work.data(), work.data() + k, threads);
+        })});
+        if (!std::is_sorted(work.begin(), work.end())) std::fprintf(stderr, "Warning: quicksort output not sorted\n");
+        results.push_back({"radix_sort", "kernel", k, bytes, 0, bench::measure(W, I, reload, [&] {
+            sorting::radixSort(work.data(), work.data() + k, threads);
+        })});
+        if (!std::is_sorted(work.begin(), work.end())) std::fprintf(stderr, "Warning: radix sort output not sorted\n");
+    }
+
+    // --- Report ---
+    std::printf("Threads: %d, GEMM kernel: %s\n", threads, gemm::isaName(gemm::selectedIsa<float>()));
+    std::printf("Peak bandwidth (best STREAM): %.2f GB/s, peak FMA rate: %.2f GFLOP/s f64, %.2f GFLOP/s f32\n\n",
+                machine.peakGBs, machine.peakGflops, machine.peakGflopsF32);
+    std::printf("%-22s %12s %12s %9s %9s %8s %8s\n", "kernel", "median ms", "p99 ms", "GB/s", "GFLOP/s", "FLOP/B",
+                "roof");
+    for (const Result& r : results) printRow(r, machine);
+
+    FILE* out = std::fopen(opt.json.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", opt.json.c_str());
+        return 1;
+    }
+    bench::JsonWriter json(out);
+    json.beginObject();
+    json.field("tool", "roofline");
+    json.field("unix_time", (long long)std::time(nullptr));
+    json.key("config").beginObject();
+    json.field("threads", threads);
+    json.field("stream_n", (long long)opt.n);
+    json.field("gemm_n", opt.gemm);
+    json.field("grid", opt.grid);
+    json.field("sort_n", (long long)opt.sort);
+    json.field("iterations", opt.iterations);
+    json.field("warmup", opt.warmup);
+    json.field("gemm_isa", gemm::isaName(gemm::selectedIsa<float>()));
+    json.endObject();
+    json.key("machine").beginObject();
+    json.field("peak_gbs", machine.peakGBs);
+    json.field("peak_gflops", machine.peakGflops);
+    json.stats("peak_fma_time", peak);
+    json.field("peak_gflops_f32", machine.peakGflopsF32);
+    json.stats("peak_fma_time_f32", peakF32);
+    json.endObject();
+    json.key("stream").beginArray();
+    for (const Result& r : results)
+        if (r.group == "stream") writeResult(json, r, machine);
+    json.endArray();
+    json.key("kernels").beginArray();
+    for (const Result& r : results)
+        if (r.group != "stream") writeResult(json, r, machine);
+    json.endArray();
+    json.endObject();
+    json.finish();
+    std::fclose(out);
+    std::printf("\nWrote %s\n", opt.json.c_str());
+    return 0;
+}
@@ -3,6 +3,9 @@
 #include <vector>
 #include <cstdlib>
 #include <cmath>
+#include "common/mpi_partition.h"
+#include "common/rng.h"
+#include "common/vexpr.h"
 
 #define N 1000000  // Total vector size
 
@@ -13,7 +16,10 @@ int main(int argc, char** argv) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    int chunk_size = N / size;
+    // Chunk sizes differ by at most one, so no elements are dropped when N % size != 0
+    std::vector<int> counts(size), displs(size);
+    partition_counts(N, size, 1, counts.data(), displs.data());
+    int chunk_size = counts[rank];
     std::vector<float> A_chunk(chunk_size), B_chunk(chunk_size), C_chunk(chunk_size);
     std::vector<float> A, B, C;
 
@@ -21,27 +27,27 @@ int main(int argc, char** argv) {
         A.resize(N);
         B.resize(N);
         C.resize(N);
-        for (int i = 0; i < N; i++) {
-            A[i] = static_cast<float>(rand()) / RAND_MAX;
-            B[i] = static_cast<float>(rand()) / RAND_MAX;
-        }
+        rng_fill_floats(A.data(), N, RNG_DEFAULT_SEED, 0.0f, 1.0f);
+        rng_fill_floats(B.data(), N, RNG_DEFAULT_SEED + 1, 0.0f, 1.0f);
     }
 
     double start_time = MPI_Wtime();
 
-    MPI_Scatter(A.data(), chunk_size, MPI_FLOAT, A_chunk.data(), chunk_size, MPI_FLOAT, 0, MPI_COMM_WORLD);
-    MPI_Scatter(B.data(), chunk_size, MPI_FLOAT, B_chunk.data(), chunk_size, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(A.data(), counts.data(), displs.data(), MPI_FLOAT, A_chunk.data(), chunk_size, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(B.data(), counts.data(), displs.data(), MPI_FLOAT, B_chunk.data(), chunk_size, MPI_FLOAT, 0, MPI_COMM_WORLD);
 
-    for (int i = 0; i < chunk_size; i++) {
-        C_chunk[i] = A_chunk[i] + B_chunk[i];
-    }
+    // Add and checksum the chunk in one pass over memory
+    double local_sum = vexpr::assignSum(vexpr::span(C_chunk), vexpr::span(A_chunk) + vexpr::span(B_chunk));
+    double total_sum = 0.0;
+    MPI_Reduce(&local_sum, &total_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    MPI_Gather(C_chunk.data(), chunk_size, MPI_FLOAT, C.data(), chunk_size, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(C_chunk.data(), chunk_size, MPI_FLOAT, C.data(), counts.data(), displs.data(), MPI_FLOAT, 0, MPI_COMM_WORLD);
 
     double end_time = MPI_Wtime();
 
     if (rank == 0) {
         std::cout << "MPI Vector Addition Completed.\n";
+        std::cout << "Sum of C: " << total_sum << "\n";
         std::cout << "MPI Execution Time: " << (end_time - start_time) * 1e9 << " ns\n";
     }
 
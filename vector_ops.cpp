@@ -5,9 +5,17 @@
 #include <cstdlib>
 #include <cmath>
 #include <chrono>
+#include <cstring>
+#include <string>
 #include <omp.h>
+#include "common/rng.h"
+#include "common/cl_buffers.h"
+#include "common/vexpr.h"
 
-#define N 1000000  // Vector size
+#define N 1000000  // Default vector size
+#define DEFAULT_CHUNKS 8
+#define SUM_LOCAL 256     // Largest work-group size of the fused add + sum kernel
+#define SUM_GROUPS 64
 
 // Error checking utility
 void checkErr(cl_int err, const char* name) {
@@ -17,22 +25,67 @@ void checkErr(cl_int err, const char* name) {
     }
 }
 
-const char* kernelSource = R"(
-__kernel void vector_add(__global const float* A,  // Input vector A
-                        __global const float* B,  // Input vector B
-                        __global float* C) {      // Output vector C
-    int i = get_global_id(0);  // Get thread ID
-    C[i] = A[i] + B[i];       // Perform addition
+// Set the arguments of a kernel generated by vexpr: the output, the arrays
+// it reads (matched to their buffers by host pointer), the per-group partial
+// sums for clAssignSum kernels, then n
+void setExprArgs(cl_kernel kernel, const vexpr::ClKernel& k, cl_mem out,
+                 const std::vector<std::pair<const void*, cl_mem>>& buffers, cl_mem partial, cl_int n) {
+    cl_uint arg = 0;
+    cl_int err = clSetKernelArg(kernel, arg++, sizeof(cl_mem), &out);
+    for (const void* array : k.arrays) {
+        size_t b = 0;
+        while (b < buffers.size() && buffers[b].first != array) b++;
+        if (b == buffers.size()) checkErr(CL_INVALID_MEM_OBJECT, k.name.c_str());
+        err |= clSetKernelArg(kernel, arg++, sizeof(cl_mem), &buffers[b].second);
+    }
+    if (partial) err |= clSetKernelArg(kernel, arg++, sizeof(cl_mem), &partial);
+    err |= clSetKernelArg(kernel, arg++, sizeof(cl_int), &n);
+    checkErr(err, "clSetKernelArg");
+}
+
+// Largest power of two up to SUM_LOCAL that a work-group of at most limit
+// work-items can hold
+size_t sumLocalSize(size_t limit) {
+    size_t local = SUM_LOCAL;
+    while (local > 1 && local > limit) local /= 2;
+    return local;
 }
-)";
-
-int main() {
-    // Initialize random vectors A and B
-    std::vector<float> A(N), B(N), C(N), C_host(N);
-    for (int i = 0; i < N; i++) {
-        A[i] = static_cast<float>(rand()) / RAND_MAX;
-        B[i] = static_cast<float>(rand()) / RAND_MAX;
+
+static long long elapsedNs(std::chrono::high_resolution_clock::time_point start,
+                           std::chrono::high_resolution_clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int n = N;
+    int chunks = DEFAULT_CHUNKS;
+    std::string mode = "auto";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            mode = argv[++i];
+        } else if (strcmp(argv[i], "--chunks") == 0 && i + 1 < argc) {
+            chunks = atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--n N] [--mode auto|zero-copy|chunked] [--chunks K]\n"
+                      << "  zero-copy  map host-allocated buffers in place (CPU / integrated GPU)\n"
+                      << "  chunked    stream through pinned staging buffers on two queues (discrete GPU)\n"
+                      << "  auto       zero-copy when the device shares host memory, else chunked\n";
+            return 1;
+        }
     }
+    if (n <= 0 || chunks <= 0 || (mode != "auto" && mode != "zero-copy" && mode != "chunked")) {
+        std::cerr << "Invalid --n, --chunks or --mode" << std::endl;
+        return 1;
+    }
+    size_t bytes = sizeof(float) * n;
+
+    // Host reference inputs; the device inputs are generated straight into
+    // the mapped buffers below from the same streams
+    std::vector<float> A(n), B(n), C_host(n);
+    rng_fill_floats(A.data(), n, RNG_DEFAULT_SEED, 0.0f, 1.0f);
+    rng_fill_floats(B.data(), n, RNG_DEFAULT_SEED + 1, 0.0f, 1.0f);
 
     // --- OpenCL Setup ---
     cl_int err;
@@ -54,6 +107,38 @@ int main() {
     checkErr(err, "clCreateContext");
     cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, 0, &err);
     checkErr(err, "clCreateCommandQueue");
+    // Second in-order queue, so chunked uploads overlap the previous chunk's kernel
+    cl_command_queue queue2 = clCreateCommandQueueWithProperties(context, device, 0, &err);
+    checkErr(err, "clCreateCommandQueue");
+    cl_command_queue queues[2] = {queue, queue2};
+
+    bool zeroCopy = mode == "zero-copy" || (mode == "auto" && cl_device_shares_host_memory(device));
+
+    // Host-accessible buffers: shared with the device on unified memory,
+    // pinned staging memory otherwise
+    cl_mapped_buffer hostA, hostB, hostC;
+    err = cl_mapped_buffer_create(&hostA, context, CL_MEM_READ_ONLY, bytes);
+    err |= cl_mapped_buffer_create(&hostB, context, CL_MEM_READ_ONLY, bytes);
+    err |= cl_mapped_buffer_create(&hostC, context, CL_MEM_WRITE_ONLY, bytes);
+    checkErr(err, "clCreateBuffer");
+    err = cl_mapped_buffer_map(&hostA, queue, CL_MAP_WRITE_INVALIDATE_REGION);
+    err |= cl_mapped_buffer_map(&hostB, queue, CL_MAP_WRITE_INVALIDATE_REGION);
+    err |= cl_mapped_buffer_map(&hostC, queue, CL_MAP_READ | CL_MAP_WRITE);
+    checkErr(err, "clEnqueueMapBuffer");
+    rng_fill_floats((float*)hostA.ptr, n, RNG_DEFAULT_SEED, 0.0f, 1.0f);
+    rng_fill_floats((float*)hostB.ptr, n, RNG_DEFAULT_SEED + 1, 0.0f, 1.0f);
+
+    // Kernels generated from the same expression the host evaluates: C = A + B,
+    // and C = A + B fused with sum(C). The sum kernel's work-group size is
+    // baked into its source, so it is sized for the device up front
+    size_t deviceMaxLocal = SUM_LOCAL;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(deviceMaxLocal), &deviceMaxLocal, nullptr);
+    size_t sumLocal = sumLocalSize(deviceMaxLocal);
+    vexpr::Span<float> a((float*)hostA.ptr, n), b((float*)hostB.ptr, n), c((float*)hostC.ptr, n);
+    vexpr::ClKernel add = vexpr::clAssign("vector_add", c, a + b);
+    vexpr::ClKernel addSum = vexpr::clAssignSum("vector_add_sum", c, a + b, (int)sumLocal);
+    std::string source = add.source + addSum.source;
+    const char* kernelSource = source.c_str();
 
     // Build OpenCL program
     cl_program program = clCreateProgramWithSource(context, 1, &kernelSource, nullptr, &err);
@@ -68,61 +153,150 @@ int main() {
         exit(1);
     }
 
-    // Create buffers
-    cl_mem bufferA = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * N, A.data(), &err);
-    cl_mem bufferB = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * N, B.data(), &err);
-    cl_mem bufferC = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * N, nullptr, &err);
-    checkErr(err, "clCreateBuffer");
 
-    // Execute kernel
-    cl_kernel kernel = clCreateKernel(program, "vector_add", &err);
+    // The kernel reads the mapped buffers themselves in zero-copy mode, and
+    // device-only buffers fed from the staging buffers in chunked mode
+    cl_mem bufferA = hostA.mem, bufferB = hostB.mem, bufferC = hostC.mem;
+    if (!zeroCopy) {
+        bufferA = clCreateBuffer(context, CL_MEM_READ_ONLY, bytes, nullptr, &err);
+        checkErr(err, "clCreateBuffer");
+        bufferB = clCreateBuffer(context, CL_MEM_READ_ONLY, bytes, nullptr, &err);
+        checkErr(err, "clCreateBuffer");
+        bufferC = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+        checkErr(err, "clCreateBuffer");
+    }
+
+    cl_mem partial = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * SUM_GROUPS, nullptr, &err);
+    checkErr(err, "clCreateBuffer");
+    std::vector<std::pair<const void*, cl_mem>> buffers = {{a.data(), bufferA}, {b.data(), bufferB}};
+    cl_kernel kernel = clCreateKernel(program, add.name.c_str(), &err);
     checkErr(err, "clCreateKernel");
-    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufferA);
-    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufferB);
-    err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufferC);
-    checkErr(err, "clSetKernelArg");
+    setExprArgs(kernel, add, bufferC, buffers, nullptr, n);
+    cl_kernel sumKernel = clCreateKernel(program, addSum.name.c_str(), &err);
+    checkErr(err, "clCreateKernel");
+    setExprArgs(sumKernel, addSum, bufferC, buffers, partial, n);
+    // The compiled kernel may allow less than the device (registers, local
+    // memory); then the fused sum is skipped rather than failing the launch
+    size_t kernelMaxLocal = sumLocal;
+    clGetKernelWorkGroupInfo(sumKernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelMaxLocal), &kernelMaxLocal,
+                             nullptr);
+    bool fusedSum = kernelMaxLocal >= sumLocal;
+    if (!fusedSum)
+        std::cerr << "Fused add + sum kernel skipped: it allows " << kernelMaxLocal << " work-items per group, "
+                  << sumLocal << " needed" << std::endl;
 
-    size_t globalSize = N;
+    // --- OpenCL run: inputs handed over, kernel, results back on the host ---
+    size_t globalSize = n;
     auto start_gpu = std::chrono::high_resolution_clock::now();
+    if (zeroCopy) {
+        // Unmapping gives the buffers to the device and mapping C gives the
+        // result back; on shared memory neither copies anything
+        err = cl_mapped_buffer_unmap(&hostA, queue);
+        err |= cl_mapped_buffer_unmap(&hostB, queue);
+        err |= cl_mapped_buffer_unmap(&hostC, queue);
+        checkErr(err, "clEnqueueUnmapMemObject");
+        err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
+        checkErr(err, "clEnqueueNDRangeKernel");
+        err = cl_mapped_buffer_map(&hostC, queue, CL_MAP_READ);
+        checkErr(err, "clEnqueueMapBuffer");
+    } else {
+        cl_stream_array inputs[2] = {{bufferA, hostA.ptr, sizeof(float)}, {bufferB, hostB.ptr, sizeof(float)}};
+        cl_stream_array output = {bufferC, hostC.ptr, sizeof(float)};
+        size_t chunk = (globalSize + chunks - 1) / chunks;
+        err = cl_stream_kernel(queues, kernel, globalSize, chunk, inputs, 2, &output, 1);
+        checkErr(err, "cl_stream_kernel");
+    }
+    auto end_gpu = std::chrono::high_resolution_clock::now();
+    // The device may not write C while the host has it mapped
+    if (zeroCopy) checkErr(cl_mapped_buffer_unmap(&hostC, queue), "clEnqueueUnmapMemObject");
+
+    // Kernel alone on the now device-resident data, for the transfer share
+    auto start_kernel = std::chrono::high_resolution_clock::now();
     err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
     checkErr(err, "clEnqueueNDRangeKernel");
     clFinish(queue);
+    auto end_kernel = std::chrono::high_resolution_clock::now();
 
-    // Read results
-    err = clEnqueueReadBuffer(queue, bufferC, CL_TRUE, 0, sizeof(float) * N, C.data(), 0, nullptr, nullptr);
-    checkErr(err, "clEnqueueReadBuffer");
-    auto end_gpu = std::chrono::high_resolution_clock::now();
+    // Fused add + sum on the device: one pass, per-group partial sums
+    size_t sumGlobal = SUM_GROUPS * sumLocal;
+    std::vector<float> partials(SUM_GROUPS);
+    auto start_fused = std::chrono::high_resolution_clock::now();
+    if (fusedSum) {
+        err = clEnqueueNDRangeKernel(queue, sumKernel, 1, nullptr, &sumGlobal, &sumLocal, 0, nullptr, nullptr);
+        checkErr(err, "clEnqueueNDRangeKernel");
+        err = clEnqueueReadBuffer(queue, partial, CL_TRUE, 0, sizeof(float) * SUM_GROUPS, partials.data(), 0, nullptr,
+                                  nullptr);
+        checkErr(err, "clEnqueueReadBuffer");
+    }
+    auto end_fused = std::chrono::high_resolution_clock::now();
+    double sum_device = 0.0;
+    for (float p : partials) sum_device += p;
+
+    if (zeroCopy) checkErr(cl_mapped_buffer_map(&hostC, queue, CL_MAP_READ), "clEnqueueMapBuffer");
+    const float* C = (const float*)hostC.ptr;
 
     // --- OpenMP (CPU) Comparison ---
     auto start_cpu = std::chrono::high_resolution_clock::now();
-    #pragma omp parallel for
-    for (int i = 0; i < N; i++) {
-        C_host[i] = A[i] + B[i];
-    }
+    vexpr::span(C_host) = vexpr::span(A) + vexpr::span(B);
     auto end_cpu = std::chrono::high_resolution_clock::now();
 
+    // Add then sum as two passes over memory, and fused into one
+    auto start_two_pass = std::chrono::high_resolution_clock::now();
+    vexpr::span(C_host) = vexpr::span(A) + vexpr::span(B);
+    double sum_two_pass = vexpr::sum(vexpr::span(C_host));
+    auto end_two_pass = std::chrono::high_resolution_clock::now();
+    auto start_one_pass = std::chrono::high_resolution_clock::now();
+    double sum_host = vexpr::assignSum(vexpr::span(C_host), vexpr::span(A) + vexpr::span(B));
+    auto end_one_pass = std::chrono::high_resolution_clock::now();
+
     // Verify results
     bool correct = true;
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < n; i++) {
         if (fabs(C[i] - C_host[i]) > 1e-5) {
             correct = false;
             break;
         }
     }
+    // The device sums in float, so allow for rounding
+    bool sumsAgree = fabs(sum_two_pass - sum_host) <= 1e-9 * fabs(sum_host) &&
+                     (!fusedSum || fabs(sum_device - sum_host) <= 1e-4 * fabs(sum_host));
 
     // --- Results ---
     std::cout << "Results are " << (correct ? "correct " : "incorrect ") << std::endl;
-    auto duration_gpu = std::chrono::duration_cast<std::chrono::nanoseconds>(end_gpu - start_gpu).count();
-    auto duration_cpu = std::chrono::duration_cast<std::chrono::nanoseconds>(end_cpu - start_cpu).count();
-    std::cout << "OpenCL time: " << duration_gpu << " ns\n";
+    std::cout << "Sum of C: " << sum_host;
+    if (fusedSum) std::cout << " (device " << sum_device << ", " << (sumsAgree ? "agrees" : "DIFFERS") << ")";
+    else std::cout << " (no device sum" << (sumsAgree ? "" : ", two-pass DIFFERS") << ")";
+    std::cout << "\n";
+    long long duration_gpu = elapsedNs(start_gpu, end_gpu);
+    long long duration_kernel = elapsedNs(start_kernel, end_kernel);
+    long long duration_cpu = elapsedNs(start_cpu, end_cpu);
+    if (zeroCopy)
+        std::cout << "Transfers: zero-copy (mapped host buffers)\n";
+    else
+        std::cout << "Transfers: pinned staging, " << chunks << " chunks on 2 queues\n";
+    std::cout << "OpenCL time (transfers + kernel): " << duration_gpu << " ns\n";
+    std::cout << "OpenCL kernel time: " << duration_kernel << " ns\n";
+    std::cout << "OpenCL transfer overhead: " << (duration_gpu > duration_kernel ? duration_gpu - duration_kernel : 0)
+              << " ns\n";
+    if (fusedSum) std::cout << "OpenCL fused add + sum kernel time: " << elapsedNs(start_fused, end_fused) << " ns\n";
     std::cout << "OpenMP (CPU) time: " << duration_cpu << " ns\n";
+    std::cout << "OpenMP add, then sum (2 passes): " << elapsedNs(start_two_pass, end_two_pass) << " ns\n";
+    std::cout << "OpenMP fused add + sum (1 pass): " << elapsedNs(start_one_pass, end_one_pass) << " ns\n";
 
     // Cleanup
-    clReleaseMemObject(bufferA);
-    clReleaseMemObject(bufferB);
-    clReleaseMemObject(bufferC);
+    if (!zeroCopy) {
+        clReleaseMemObject(bufferA);
+        clReleaseMemObject(bufferB);
+        clReleaseMemObject(bufferC);
+    }
+    cl_mapped_buffer_release(&hostA, queue);
+    cl_mapped_buffer_release(&hostB, queue);
+    cl_mapped_buffer_release(&hostC, queue);
+    clReleaseMemObject(partial);
+    clReleaseKernel(sumKernel);
     clReleaseKernel(kernel);
     clReleaseProgram(program);
+    clReleaseCommandQueue(queue2);
     clReleaseCommandQueue(queue);
     clReleaseContext(context);
 